@@ -0,0 +1,126 @@
+// @file:     bboxkernels.cc
+// @author:   Samuel Ng
+// @created:  2021-03-01
+// @license:  GNU LGPL v3
+//
+// @desc:     Scalar, SSE4.1 and AVX2 implementations of the batched bounding
+//            box kernels. The vector kernels are compiled for their target
+//            with function attributes so that the rest of the program keeps
+//            the baseline instruction set.
+
+#include <algorithm>
+#include "bboxkernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace sp;
+
+namespace {
+
+  void bboxSpansScalar(const int *xs, const int *ys, int n_groups,
+      int n_slots, int y_weight, int *spans)
+  {
+    for (int g=0; g<n_groups; g++) {
+      const int *gx = xs + g * n_slots * BBOX_GROUP_LANES;
+      const int *gy = ys + g * n_slots * BBOX_GROUP_LANES;
+      for (int l=0; l<BBOX_GROUP_LANES; l++) {
+        int x_min = gx[l], x_max = gx[l], y_min = gy[l], y_max = gy[l];
+        for (int k=1; k<n_slots; k++) {
+          x_min = std::min(x_min, gx[k * BBOX_GROUP_LANES + l]);
+          x_max = std::max(x_max, gx[k * BBOX_GROUP_LANES + l]);
+          y_min = std::min(y_min, gy[k * BBOX_GROUP_LANES + l]);
+          y_max = std::max(y_max, gy[k * BBOX_GROUP_LANES + l]);
+        }
+        spans[g * BBOX_GROUP_LANES + l] = (x_max - x_min) + y_weight * (y_max - y_min);
+      }
+    }
+  }
+
+#ifdef SP_X86_KERNELS
+  __attribute__((target("sse4.1")))
+  void bboxSpansSSE41(const int *xs, const int *ys, int n_groups,
+      int n_slots, int y_weight, int *spans)
+  {
+    const __m128i weight = _mm_set1_epi32(y_weight);
+    // each group is processed as two halves of four lanes
+    for (int h=0; h<2*n_groups; h++) {
+      const int *gx = xs + (h / 2) * n_slots * BBOX_GROUP_LANES + (h % 2) * 4;
+      const int *gy = ys + (h / 2) * n_slots * BBOX_GROUP_LANES + (h % 2) * 4;
+      __m128i x_min = _mm_loadu_si128((const __m128i *)gx);
+      __m128i y_min = _mm_loadu_si128((const __m128i *)gy);
+      __m128i x_max = x_min;
+      __m128i y_max = y_min;
+      for (int k=1; k<n_slots; k++) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(gx + k * BBOX_GROUP_LANES));
+        __m128i y = _mm_loadu_si128((const __m128i *)(gy + k * BBOX_GROUP_LANES));
+        x_min = _mm_min_epi32(x_min, x);
+        x_max = _mm_max_epi32(x_max, x);
+        y_min = _mm_min_epi32(y_min, y);
+        y_max = _mm_max_epi32(y_max, y);
+      }
+      __m128i span = _mm_add_epi32(_mm_sub_epi32(x_max, x_min),
+          _mm_mullo_epi32(weight, _mm_sub_epi32(y_max, y_min)));
+      _mm_storeu_si128((__m128i *)(spans + 4 * h), span);
+    }
+  }
+
+  __attribute__((target("avx2")))
+  void bboxSpansAVX2(const int *xs, const int *ys, int n_groups,
+      int n_slots, int y_weight, int *spans)
+  {
+    const __m256i weight = _mm256_set1_epi32(y_weight);
+    for (int g=0; g<n_groups; g++) {
+      const int *gx = xs + g * n_slots * BBOX_GROUP_LANES;
+      const int *gy = ys + g * n_slots * BBOX_GROUP_LANES;
+      __m256i x_min = _mm256_loadu_si256((const __m256i *)gx);
+      __m256i y_min = _mm256_loadu_si256((const __m256i *)gy);
+      __m256i x_max = x_min;
+      __m256i y_max = y_min;
+      for (int k=1; k<n_slots; k++) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(gx + k * BBOX_GROUP_LANES));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(gy + k * BBOX_GROUP_LANES));
+        x_min = _mm256_min_epi32(x_min, x);
+        x_max = _mm256_max_epi32(x_max, x);
+        y_min = _mm256_min_epi32(y_min, y);
+        y_max = _mm256_max_epi32(y_max, y);
+      }
+      __m256i span = _mm256_add_epi32(_mm256_sub_epi32(x_max, x_min),
+          _mm256_mullo_epi32(weight, _mm256_sub_epi32(y_max, y_min)));
+      _mm256_storeu_si256((__m256i *)(spans + g * BBOX_GROUP_LANES), span);
+    }
+  }
+#endif
+
+}
+
+SimdLevel sp::detectSimdLevel()
+{
+#ifdef SP_X86_KERNELS
+  static const SimdLevel level = __builtin_cpu_supports("avx2") ? SimdLevel::AVX2
+    : __builtin_cpu_supports("sse4.1") ? SimdLevel::SSE41 : SimdLevel::Scalar;
+  return level;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+void sp::bboxSpans(SimdLevel level, const int *xs, const int *ys, int n_groups,
+    int n_slots, int y_weight, int *spans)
+{
+  switch (level) {
+#ifdef SP_X86_KERNELS
+    case SimdLevel::AVX2:
+      bboxSpansAVX2(xs, ys, n_groups, n_slots, y_weight, spans);
+      break;
+    case SimdLevel::SSE41:
+      bboxSpansSSE41(xs, ys, n_groups, n_slots, y_weight, spans);
+      break;
+#endif
+    default:
+      bboxSpansScalar(xs, ys, n_groups, n_slots, y_weight, spans);
+      break;
+  }
+}
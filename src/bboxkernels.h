@@ -0,0 +1,50 @@
+/*!
+  \file bboxkernels.h
+  \brief Batched bounding box kernels with runtime instruction set dispatch.
+  \author Samuel Ng
+  \date 2021-03-01 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _SP_BBOXKERNELS_H_
+#define _SP_BBOXKERNELS_H_
+
+namespace sp {
+
+  //! Instruction set used by the batched bounding box kernels.
+  enum class SimdLevel {
+    //! Plain C++ loops.
+    Scalar,
+    //! 4 lanes of 32 bit integers.
+    SSE41,
+    //! 8 lanes of 32 bit integers.
+    AVX2
+  };
+
+  //! Number of lanes of a group, the nets evaluated together.
+  const int BBOX_GROUP_LANES = 8;
+
+  //! Largest number of pin slots of each lane, the largest net size handled.
+  const int BBOX_PIN_SLOTS = 8;
+
+  //! Number of coordinates of a group with BBOX_PIN_SLOTS slots, pin slot k 
+  //! of lane l is stored at k * BBOX_GROUP_LANES + l.
+  const int BBOX_GROUP_INTS = BBOX_GROUP_LANES * BBOX_PIN_SLOTS;
+
+  //! Return the best instruction set supported by the running CPU.
+  SimdLevel detectSimdLevel();
+
+  //! \brief Compute the bounding box spans of groups of nets.
+  //!
+  //! xs and ys hold n_groups consecutive groups of n_slots * BBOX_GROUP_LANES
+  //! pin coordinates (1 <= n_slots <= BBOX_PIN_SLOTS), nets with fewer pins 
+  //! than n_slots repeat one of their pins in the unused slots. Writes 
+  //! (x_max - x_min) + y_weight * (y_max - y_min) of each lane to spans, which
+  //! must hold n_groups * BBOX_GROUP_LANES values. The level must be 
+  //! supported by the running CPU.
+  void bboxSpans(SimdLevel level, const int *xs, const int *ys, int n_groups,
+      int n_slots, int y_weight, int *spans);
+
+}
+
+#endif
@@ -7,10 +7,31 @@
 
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <sys/resource.h>
 #include "benchmarker.h"
+#include "netlistgen.h"
+#include "placer/smallplacer.h"
+#include "placer/eco.h"
 
 using namespace cli;
 
+namespace {
+
+  // return whether the integer read for an enum setting is one of its values
+  // up to last, warn about the setting otherwise
+  template<class Enum>
+  bool enumSettingInRange(const QString &key, int value, Enum last)
+  {
+    if (value < 0 || value > static_cast<int>(last)) {
+      qWarning() << "Out of range value" << value << "for setting" << key 
+        << "ignored.";
+      return false;
+    }
+    return true;
+  }
+
+}
+
 // static declarations
 QMap<QPair<QString, int>, pc::SAResults> Benchmarker::bench_results;
 std::mutex Benchmarker::result_store_mutex;
@@ -43,7 +64,7 @@ void Benchmarker::runBenchmarks()
     int repeat = repeat_count;
     while (repeat--) {
       QString f_path = ":/benchmarks/" + bench_name + ".txt";
-      BenchmarkTask task(bench_name, repeat, f_path, sa_settings);
+      BenchmarkTask task(bench_name, repeat, f_path, sa_settings, load_settings);
       std::thread th(&BenchmarkTask::runBenchmark, task);
       threads.push_back(std::move(th));
     }
@@ -60,14 +81,20 @@ void Benchmarker::runBenchmarks()
   for (const QString &bench_name : bench_names) {
     QList<QVariant> costs;
     QList<QVariant> its;
+    QList<QVariant> init_costs;
+    QList<QVariant> runtimes;
     for (int i=0; i<repeat_count; i++) {
       pc::SAResults r = bench_results.value(qMakePair(bench_name, i));
       costs.append(r.cost);
       its.append(r.iterations);
+      init_costs.append(r.init_cost);
+      runtimes.append(r.runtime_ms);
     }
     QVariantMap bench_map;
     bench_map["costs"] = costs;
     bench_map["iterations"] = its;
+    bench_map["init_costs"] = init_costs;
+    bench_map["runtime_ms"] = runtimes;
     result_map.insert(bench_name, bench_map);
   }
 
@@ -80,6 +107,163 @@ void Benchmarker::runBenchmarks()
   qDebug() << "Results written to " << json_out_path;
 }
 
+void Benchmarker::runScalingSuite(const QList<int> &sizes, unsigned int seed)
+{
+  QFile f_out(json_out_path);
+  if (!f_out.open(QIODevice::WriteOnly)) {
+    qDebug() << "Failed to open " << f_out << " for writing.";
+    exit(1);
+  }
+
+  // the default move budget is impractical for large netlists, use a short 
+  // fixed-length anneal unless the user provided their own settings
+  pc::SASettings scaling_settings = sa_settings;
+  if (!custom_settings) {
+    scaling_settings.swap_fact = 1;
+    scaling_settings.max_its = 20;
+  }
+
+  // sizes run sequentially in ascending order so that timings don't compete
+  // for cores and the process peak memory reflects the current size
+  QList<int> sorted_sizes = sizes;
+  std::sort(sorted_sizes.begin(), sorted_sizes.end());
+  QVariantMap result_map;
+
+  // each run is repeated with the multilevel flow toggled, so that flat and
+  // multilevel placement are compared on the same netlists
+  pc::SASettings compare_settings = scaling_settings;
+  compare_settings.multilevel = !scaling_settings.multilevel;
+  QString compare_name = compare_settings.multilevel ? "multilevel" : "flat";
+  for (int size : sorted_sizes) {
+    qDebug() << "Generating synthetic netlist with" << size << "blocks...";
+    GenSettings gen_settings;
+    gen_settings.n_blocks = size;
+    gen_settings.seed = seed;
+    NetlistGenerator gen(gen_settings);
+    QString f_path = QDir::temp().filePath(QString("placer_scaling_%1.txt").arg(size));
+    if (!gen.writeToFile(f_path)) {
+      continue;
+    }
+    sp::Chip chip(f_path, load_settings.rcm_renumber, load_settings.grid_layout);
+    prepareChip(&chip, load_settings);
+    QFile::remove(f_path);
+
+    QList<QVariant> costs, its, moves, evals, runtimes, moves_per_sec, peak_mem;
+    QList<QVariant> compare_costs, compare_runtimes;
+    for (int i=0; i<repeat_count; i++) {
+      qDebug() << "Placing" << size << "blocks, run" << i;
+      QElapsedTimer timer;
+      timer.start();
+      pc::SAResults r = placeChip(&chip, scaling_settings, load_settings);
+      qint64 runtime = std::max(timer.elapsed(), (qint64)1);
+      costs.append(r.cost);
+      its.append(r.iterations);
+      moves.append((qint64)r.moves);
+      evals.append((qint64)r.evaluations);
+      runtimes.append(runtime);
+      moves_per_sec.append(r.moves * 1000. / runtime);
+      peak_mem.append((qint64)peakMemoryKB());
+
+      timer.start();
+      r = placeChip(&chip, compare_settings, load_settings);
+      compare_costs.append(r.cost);
+      compare_runtimes.append(std::max(timer.elapsed(), (qint64)1));
+    }
+    QVariantMap size_map;
+    size_map["nx"] = chip.dimX();
+    size_map["ny"] = chip.dimY();
+    size_map["n_nets"] = chip.numNets();
+    size_map["costs"] = costs;
+    size_map["iterations"] = its;
+    size_map["moves"] = moves;
+    size_map["evaluations"] = evals;
+    size_map["runtime_ms"] = runtimes;
+    size_map["moves_per_sec"] = moves_per_sec;
+    size_map["peak_mem_kb"] = peak_mem;
+    size_map[compare_name + "_costs"] = compare_costs;
+    size_map[compare_name + "_runtime_ms"] = compare_runtimes;
+    result_map.insert(QString::number(size), size_map);
+  }
+
+  QJsonDocument json_doc(QJsonObject::fromVariantMap(result_map));
+  f_out.write(json_doc.toJson());
+  f_out.close();
+  qDebug() << "Scaling results written to " << json_out_path;
+}
+
+bool Benchmarker::runCheckpointed(const QString &f_path, 
+    const QString &checkpoint_path, int checkpoint_its, const QString &resume_path)
+{
+  sp::Chip chip(f_path, load_settings.rcm_renumber, load_settings.grid_layout);
+  if (!chip.isInitialized()) {
+    return false;
+  }
+  prepareChip(&chip, load_settings);
+
+  pc::Placer placer(&chip);
+  placer.setCheckpointing(checkpoint_path, checkpoint_its);
+  QElapsedTimer timer;
+  timer.start();
+  pc::SAResults r = resume_path.isEmpty() ? placer.runPlacer(sa_settings)
+    : placer.resumePlacer(sa_settings, resume_path);
+  if (r.cost < 0) {
+    return false;
+  }
+  // the placement is complete, nothing is left to resume
+  if (!checkpoint_path.isEmpty()) {
+    QFile::remove(checkpoint_path);
+  }
+  return writeRunResults(&chip, r, timer.elapsed());
+}
+
+bool Benchmarker::runEco(const QString &f_path, const QString &old_placement_path)
+{
+  sp::Chip chip(f_path, load_settings.rcm_renumber, load_settings.grid_layout);
+  if (!chip.isInitialized()) {
+    return false;
+  }
+  prepareChip(&chip, load_settings);
+
+  QElapsedTimer timer;
+  timer.start();
+  pc::EcoPlacer eco(&chip);
+  if (!eco.loadPlacement(old_placement_path)) {
+    return false;
+  }
+  qDebug() << "Inserted" << eco.insertedBlocks().size() << "of" << chip.numBlocks()
+    << "blocks";
+  pc::SAResults r = eco.refine(sa_settings);
+  if (r.cost < 0) {
+    return false;
+  }
+  return writeRunResults(&chip, r, timer.elapsed());
+}
+
+bool Benchmarker::writeRunResults(sp::Chip *chip, const pc::SAResults &r, 
+    qint64 runtime_ms)
+{
+  if (!placement_out_path.isEmpty() && !chip->writePlacement(placement_out_path)) {
+    return false;
+  }
+  QFile f_out(json_out_path);
+  if (!f_out.open(QIODevice::WriteOnly)) {
+    qDebug() << "Failed to open " << f_out << " for writing.";
+    return false;
+  }
+  QVariantMap result_map;
+  result_map["cost"] = r.cost;
+  result_map["init_cost"] = r.init_cost;
+  result_map["iterations"] = r.iterations;
+  result_map["moves"] = (qint64)r.moves;
+  result_map["evaluations"] = (qint64)r.evaluations;
+  result_map["runtime_ms"] = runtime_ms;
+  QJsonDocument json_doc(QJsonObject::fromVariantMap(result_map));
+  f_out.write(json_doc.toJson());
+  f_out.close();
+  qDebug() << "Placement cost" << r.cost << "written to" << json_out_path;
+  return true;
+}
+
 void Benchmarker::storeResults(const QString &bench_name, int bench_id,
     pc::SAResults results)
 {
@@ -88,6 +272,41 @@ void Benchmarker::storeResults(const QString &bench_name, int bench_id,
   result_store_mutex.unlock();
 }
 
+long Benchmarker::peakMemoryKB()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;  // reported in bytes on macOS
+#else
+  return usage.ru_maxrss;         // reported in kB on Linux
+#endif
+}
+
+void Benchmarker::prepareChip(sp::Chip *chip, const LoadSettings &load_settings)
+{
+  chip->setCostModel(load_settings.cost_model);
+  if (load_settings.preprocess_nets) {
+    sp::NetReduction reduction = chip->preprocessNets();
+    qDebug() << QString("Net preprocessing: %1 -> %2 nets, %3 -> %4 pins")
+      .arg(reduction.nets_before).arg(reduction.nets_after)
+      .arg(reduction.pins_before).arg(reduction.pins_after);
+  }
+}
+
+pc::SAResults Benchmarker::placeChip(sp::Chip *chip, 
+    const pc::SASettings &sa_settings, const LoadSettings &load_settings)
+{
+  if (load_settings.small_engine && pc::SmallPlacer::supports(chip, sa_settings)) {
+    pc::SmallPlacer placer(chip);
+    return placer.runPlacer(sa_settings);
+  }
+  pc::Placer placer(chip);
+  return placer.runPlacer(sa_settings);
+}
+
 void Benchmarker::readSettings(const QString &settings_path)
 {
   qDebug() << "Reading benchmark settings from" << settings_path;
@@ -116,13 +335,98 @@ void Benchmarker::readSettings(const QString &settings_path)
   if (json_obj.isEmpty()) {
     qFatal("JSON object is empty");
   }
+  custom_settings = true;
 
   // iterate through all key value pairs and make appropriate settings
   for (auto json_it=json_obj.constBegin(); json_it!=json_obj.constEnd(); json_it++) {
     if (json_it.key() == "t_schd") {
       int t_schd_int = json_it.value().toInt();
-      sa_settings.t_schd = (t_schd_int == 0) ? pc::TSchd::ExpDecayTUpdate
-        : pc::TSchd::StdDevTUpdate;
+      if (t_schd_int == 0) {
+        sa_settings.t_schd = pc::TSchd::ExpDecayTUpdate;
+      } else if (t_schd_int == 2) {
+        sa_settings.t_schd = pc::TSchd::LamTUpdate;
+      } else {
+        sa_settings.t_schd = pc::TSchd::StdDevTUpdate;
+      }
+    } else if (json_it.key() == "init_place") {
+      int init_place = json_it.value().toInt();
+      if (enumSettingInRange(json_it.key(), init_place, pc::InitPlace::MinCutInit)) {
+        sa_settings.init_place = static_cast<pc::InitPlace>(init_place);
+      }
+    } else if (json_it.key() == "constructive_t_fact") {
+      sa_settings.constructive_t_fact = json_it.value().toDouble();
+    } else if (json_it.key() == "constructive_rw_dim") {
+      sa_settings.constructive_rw_dim = json_it.value().toInt();
+    } else if (json_it.key() == "qp_rounds") {
+      sa_settings.qp_rounds = json_it.value().toInt();
+    } else if (json_it.key() == "skip_anneal") {
+      sa_settings.skip_anneal = json_it.value().toBool();
+    } else if (json_it.key() == "lam_its") {
+      sa_settings.lam_its = json_it.value().toInt();
+    } else if (json_it.key() == "lam_plateau") {
+      sa_settings.lam_plateau = json_it.value().toDouble();
+    } else if (json_it.key() == "lam_min_moves_fact") {
+      sa_settings.lam_min_moves_fact = json_it.value().toDouble();
+    } else if (json_it.key() == "lam_eq_its") {
+      sa_settings.lam_eq_its = json_it.value().toInt();
+    } else if (json_it.key() == "directed_ratio") {
+      sa_settings.directed_ratio = json_it.value().toDouble();
+    } else if (json_it.key() == "directed_adaptive") {
+      sa_settings.directed_adaptive = json_it.value().toBool();
+    } else if (json_it.key() == "p_shift") {
+      sa_settings.p_shift = json_it.value().toDouble();
+    } else if (json_it.key() == "p_rotate") {
+      sa_settings.p_rotate = json_it.value().toDouble();
+    } else if (json_it.key() == "p_cluster") {
+      sa_settings.p_cluster = json_it.value().toDouble();
+    } else if (json_it.key() == "batch_size") {
+      sa_settings.batch_size = json_it.value().toInt();
+    } else if (json_it.key() == "block_order") {
+      int block_order = json_it.value().toInt();
+      if (enumSettingInRange(json_it.key(), block_order, pc::BlockOrder::LocalitySweep)) {
+        sa_settings.block_order = static_cast<pc::BlockOrder>(block_order);
+      }
+    } else if (json_it.key() == "rcm_renumber") {
+      load_settings.rcm_renumber = json_it.value().toBool();
+    } else if (json_it.key() == "grid_layout") {
+      int grid_layout = json_it.value().toInt();
+      if (enumSettingInRange(json_it.key(), grid_layout, sp::GridLayout::SparseHash)) {
+        load_settings.grid_layout = static_cast<sp::GridLayout>(grid_layout);
+      }
+    } else if (json_it.key() == "cost_model") {
+      int cost_model = json_it.value().toInt();
+      if (enumSettingInRange(json_it.key(), cost_model, sp::CostModel::Star)) {
+        load_settings.cost_model = static_cast<sp::CostModel>(cost_model);
+      }
+    } else if (json_it.key() == "small_engine") {
+      load_settings.small_engine = json_it.value().toBool();
+    } else if (json_it.key() == "preprocess_nets") {
+      load_settings.preprocess_nets = json_it.value().toBool();
+    } else if (json_it.key() == "rejection_free") {
+      sa_settings.rejection_free = json_it.value().toBool();
+    } else if (json_it.key() == "rf_threshold") {
+      sa_settings.rf_threshold = json_it.value().toDouble();
+    } else if (json_it.key() == "keep_best") {
+      sa_settings.keep_best = json_it.value().toBool();
+    } else if (json_it.key() == "time_budget_ms") {
+      sa_settings.time_budget_ms = json_it.value().toInt();
+    } else if (json_it.key() == "approx_net_size") {
+      sa_settings.approx_net_size = json_it.value().toInt();
+    } else if (json_it.key() == "approx_t_fact") {
+      sa_settings.approx_t_fact = json_it.value().toDouble();
+    } else if (json_it.key() == "finish_mode") {
+      int finish_mode = json_it.value().toInt();
+      if (enumSettingInRange(json_it.key(), finish_mode, pc::FinishMode::GainFinish)) {
+        sa_settings.finish_mode = static_cast<pc::FinishMode>(finish_mode);
+      }
+    } else if (json_it.key() == "dp_win_w") {
+      sa_settings.dp_win_w = json_it.value().toInt();
+    } else if (json_it.key() == "dp_win_h") {
+      sa_settings.dp_win_h = json_it.value().toInt();
+    } else if (json_it.key() == "init_t_fact") {
+      sa_settings.init_t_fact = json_it.value().toDouble();
+    } else if (json_it.key() == "init_rw_dim") {
+      sa_settings.init_rw_dim = json_it.value().toInt();
     } else if (json_it.key() == "decay_b") {
       sa_settings.decay_b = json_it.value().toDouble();
     } else if (json_it.key() == "swap_fact") {
@@ -139,8 +443,22 @@ void Benchmarker::readSettings(const QString &settings_path)
       sa_settings.min_rw_dim = json_it.value().toInt();
     } else if (json_it.key() == "rw_dim_delta") {
       sa_settings.rw_dim_delta = json_it.value().toInt();
+    } else if (json_it.key() == "multilevel") {
+      sa_settings.multilevel = json_it.value().toBool();
+    } else if (json_it.key() == "ml_coarsest_blocks") {
+      sa_settings.ml_coarsest_blocks = json_it.value().toInt();
+    } else if (json_it.key() == "ml_refine_t_fact") {
+      sa_settings.ml_refine_t_fact = json_it.value().toDouble();
+    } else if (json_it.key() == "ml_refine_rw_dim") {
+      sa_settings.ml_refine_rw_dim = json_it.value().toInt();
+    } else if (json_it.key() == "ml_refine_swap_fact") {
+      sa_settings.ml_refine_swap_fact = json_it.value().toDouble();
+    } else if (json_it.key() == "ml_refine_its") {
+      sa_settings.ml_refine_its = json_it.value().toInt();
     } else if (json_it.key() == "sanity_check") {
       sa_settings.sanity_check = json_it.value().toBool();
+    } else if (json_it.key() == "specialized_loop") {
+      sa_settings.specialized_loop = json_it.value().toBool();
     } else if (json_it.key() == "show_stdout") {
       sa_settings.show_stdout = json_it.value().toBool();
     } else {
@@ -153,15 +471,19 @@ void Benchmarker::readSettings(const QString &settings_path)
 // BenchmarkTask class implementation
 
 BenchmarkTask::BenchmarkTask(const QString &bench_name, int bench_id,
-    const QString &f_path, const pc::SASettings &sa_settings)
+    const QString &f_path, const pc::SASettings &sa_settings, 
+    const LoadSettings &load_settings)
   : bench_name(bench_name), bench_id(bench_id), f_path(f_path),
-    sa_settings(sa_settings)
+    sa_settings(sa_settings), load_settings(load_settings)
 {}
 
 void BenchmarkTask::runBenchmark()
 {
-  sp::Chip chip(f_path);
-  pc::Placer placer(&chip);
-  pc::SAResults results = placer.runPlacer(sa_settings);
+  sp::Chip chip(f_path, load_settings.rcm_renumber, load_settings.grid_layout);
+  Benchmarker::prepareChip(&chip, load_settings);
+  QElapsedTimer timer;
+  timer.start();
+  pc::SAResults results = Benchmarker::placeChip(&chip, sa_settings, load_settings);
+  results.runtime_ms = timer.elapsed();
   Benchmarker::storeResults(bench_name, bench_id, results);
 }
@@ -14,6 +14,16 @@
 
 namespace cli {
 
+  //! Options applied to the problems when loading them.
+  struct LoadSettings
+  {
+    bool rcm_renumber=false;  //!< Renumber blocks by reverse Cuthill-McKee ordering.
+    sp::GridLayout grid_layout=sp::GridLayout::ColumnMajor; //!< Memory layout of the grid.
+    bool preprocess_nets=false; //!< Drop zero cost nets and merge identical nets.
+    sp::CostModel cost_model=sp::CostModel::HPWL; //!< Net cost model.
+    bool small_engine=true;   //!< Place chips within the SmallPlacer bounds with it.
+  };
+
   //! Run benchmarks in multiple threads.
   class Benchmarker
   {
@@ -28,20 +38,68 @@ namespace cli {
     //! Run benchmarks.
     void runBenchmarks();
 
+    //! \brief Run the scaling suite.
+    //!
+    //! Generate synthetic netlists of the specified block counts with the 
+    //! given seed and place each of them sequentially, recording moves per 
+    //! second, peak memory and final cost against problem size.
+    void runScalingSuite(const QList<int> &sizes, unsigned int seed);
+
+    //! \brief Place a single problem with periodic checkpoints.
+    //!
+    //! Place the problem at f_path with the Placer, writing the annealing 
+    //! state to checkpoint_path every checkpoint_its steps unless the path 
+    //! is empty, and write the results to the output JSON. If resume_path is not empty, the anneal
+    //! continues from the checkpoint at that path, which must have been 
+    //! written with the same settings. The checkpoint is removed once the 
+    //! placement is complete. Return whether successful.
+    bool runCheckpointed(const QString &f_path, const QString &checkpoint_path,
+        int checkpoint_its, const QString &resume_path="");
+
+    //! \brief Re-place a changed problem from the placement of its earlier
+    //! version.
+    //!
+    //! Load the placement file at old_placement_path onto the problem at 
+    //! f_path with the EcoPlacer, anneal around the inserted blocks and write
+    //! the results to the output JSON. Return whether successful.
+    bool runEco(const QString &f_path, const QString &old_placement_path);
+
+    //! Write the final placement of runCheckpointed and runEco to the given
+    //! path, empty to not write it.
+    void setPlacementOutPath(const QString &path) {placement_out_path = path;}
+
     //! Store results.
     static void storeResults(const QString &bench_name, int bench_id, 
         pc::SAResults results);
 
+    //! Apply the post-loading options of the load settings to the chip.
+    static void prepareChip(sp::Chip *chip, const LoadSettings &load_settings);
+
+    //! Place the chip with the fixed-size SmallPlacer if enabled and 
+    //! supported, or with the Placer otherwise.
+    static pc::SAResults placeChip(sp::Chip *chip, const pc::SASettings &sa_settings,
+        const LoadSettings &load_settings);
+
   private:
 
     //! Read and store settings if path specified.
     void readSettings(const QString &settings_path);
 
+    //! Return the peak resident memory of this process in kB.
+    static long peakMemoryKB();
+
+    //! Write the placement of a single problem run if requested and its 
+    //! results to the output JSON. Return whether successful.
+    bool writeRunResults(sp::Chip *chip, const pc::SAResults &r, qint64 runtime_ms);
+
     // Private variables
     QString json_out_path;          //!< Output path to write to.
+    QString placement_out_path;     //!< Final placement path of single problem runs, empty for none.
     int repeat_count;               //!< Repeat each benchmark for this many times.
     QStringList bench_names;        //!< File names of the benchmarks (excluding txt).
     pc::SASettings sa_settings;     //!< Placement settings.
+    bool custom_settings=false;     //!< Whether settings were read from file.
+    LoadSettings load_settings;     //!< Problem loading options.
     std::vector<std::thread> threads; //!< Benchmarking threads.
     static QMap<QPair<QString, int>, pc::SAResults> bench_results;
 
@@ -54,7 +112,8 @@ namespace cli {
   public:
     //! Constructor taking the benchmark problem file path.
     BenchmarkTask(const QString &bench_name, int bench_id, 
-        const QString &f_path, const pc::SASettings &sa_settings);
+        const QString &f_path, const pc::SASettings &sa_settings,
+        const LoadSettings &load_settings=LoadSettings());
 
     //! Run the benchmark at the given path and store the result to Benchmarker.
     void runBenchmark();
@@ -65,6 +124,7 @@ namespace cli {
     int bench_id;
     QString f_path;
     pc::SASettings sa_settings;
+    LoadSettings load_settings;
   };
 
 }
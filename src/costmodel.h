@@ -0,0 +1,166 @@
+/*!
+  \file costmodel.h
+  \brief Net cost model policies.
+  \author Samuel Ng
+  \date 2021-02-27 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _SP_COSTMODEL_H_
+#define _SP_COSTMODEL_H_
+
+#include <QtGlobal>
+#include <climits>
+#include <algorithm>
+
+namespace sp {
+
+  //! Selection of the net cost model policy used by the chip.
+  enum class CostModel {
+    //! Half-perimeter wirelength with vertical spans counted twice.
+    HPWL,
+    //! HPWL scaled by the expected crossing count of the net size.
+    WeightedHPWL,
+    //! Squared bounding box spans, penalizing long nets.
+    SquaredDist,
+    //! Squared distances of the pins to the net centroid.
+    Star
+  };
+
+  //! Bounding box of the pins added so far.
+  struct BBoxAcc
+  {
+    int x_min=INT_MAX;
+    int x_max=INT_MIN;
+    int y_min=INT_MAX;
+    int y_max=INT_MIN;
+
+    //! Add a pin at the specified cell.
+    void add(int x, int y)
+    {
+      x_min = std::min(x_min, x);
+      x_max = std::max(x_max, x);
+      y_min = std::min(y_min, y);
+      y_max = std::max(y_max, y);
+    }
+  };
+
+  //! Pin count and the first and second moments of the pin coordinates
+  //! added so far.
+  struct MomentAcc
+  {
+    int n=0;
+    qint64 sx=0;
+    qint64 sxx=0;
+    qint64 sy=0;
+    qint64 syy=0;
+
+    //! Add a pin at the specified cell.
+    void add(int x, int y)
+    {
+      n++;
+      sx += x;
+      sxx += (qint64)x * x;
+      sy += y;
+      syy += (qint64)y * y;
+    }
+  };
+
+  /*! \brief Cost model policies.
+   *
+   * Each policy names the accumulator its pins are gathered into and computes
+   * the unweighted cost of a net from the filled accumulator and the pin
+   * count. Policies are plain structs with static members so that templated
+   * cost loops inline them, and take the weight of vertical distances, which
+   * accounts for the routing tracks, as a template parameter. Costs are 
+   * 64-bit since the crossing factor of nets with thousands of pins times 
+   * their span exceeds the int range on large chips.
+   */
+  template<int YWeight>
+  struct HPWLPolicy
+  {
+    typedef BBoxAcc Acc;
+    static const int Y_WEIGHT = YWeight;
+
+    //! Weighted bounding box span, the cost is spanFactor times this.
+    static int span(const Acc &acc)
+    {return (acc.x_max - acc.x_min) + Y_WEIGHT * (acc.y_max - acc.y_min);}
+
+    //! Cost per unit of span of a net with the specified pin count.
+    static int spanFactor(int)
+    {return 1;}
+
+    static qint64 cost(const Acc &acc, int)
+    {return span(acc);}
+  };
+
+  //! HPWL multiplied by the crossing count correction of Cheng for nets with
+  //! more than three pins, in hundredths.
+  template<int YWeight>
+  struct WeightedHPWLPolicy
+  {
+    typedef BBoxAcc Acc;
+    static const int Y_WEIGHT = YWeight;
+
+    static int crossingFactor(int n_pins)
+    {
+      static const int q[51] = {100, 100, 100, 100, 108, 115, 122, 128, 134,
+        140, 145, 150, 155, 159, 164, 169, 173, 177, 181, 185, 189, 193, 197,
+        200, 204, 207, 211, 214, 217, 220, 223, 226, 230, 233, 236, 239, 242,
+        245, 248, 251, 254, 256, 259, 261, 264, 266, 269, 271, 274, 277, 279};
+      return (n_pins <= 50) ? q[n_pins] : (27933 + 2616 * (n_pins - 50)) / 100;
+    }
+
+    //! Weighted bounding box span, the cost is spanFactor times this.
+    static int span(const Acc &acc)
+    {return HPWLPolicy<YWeight>::span(acc);}
+
+    //! Cost per unit of span of a net with the specified pin count.
+    static int spanFactor(int n_pins)
+    {return crossingFactor(n_pins);}
+
+    static qint64 cost(const Acc &acc, int n_pins)
+    {return (qint64)crossingFactor(n_pins) * span(acc);}
+  };
+
+  //! Squared horizontal and vertical bounding box spans.
+  template<int YWeight>
+  struct SquaredDistPolicy
+  {
+    typedef BBoxAcc Acc;
+    static const int Y_WEIGHT = YWeight;
+
+    static qint64 cost(const Acc &acc, int)
+    {
+      qint64 dx = acc.x_max - acc.x_min;
+      qint64 dy = acc.y_max - acc.y_min;
+      return dx * dx + Y_WEIGHT * dy * dy;
+    }
+  };
+
+  //! Sum of squared distances from the pins to their centroid, rounded down.
+  template<int YWeight>
+  struct StarPolicy
+  {
+    typedef MomentAcc Acc;
+    static const int Y_WEIGHT = YWeight;
+
+    static qint64 cost(const Acc &acc, int)
+    {
+      if (acc.n == 0) {
+        return 0;
+      }
+      return (acc.n * acc.sxx - acc.sx * acc.sx) / acc.n
+        + Y_WEIGHT * ((acc.n * acc.syy - acc.sy * acc.sy) / acc.n);
+    }
+  };
+
+  //! The policies selected by CostModel, vertical distances counted twice.
+  typedef HPWLPolicy<2> HPWLModel;
+  typedef WeightedHPWLPolicy<2> WeightedHPWLModel;
+  typedef SquaredDistPolicy<2> SquaredDistModel;
+  typedef StarPolicy<2> StarModel;
+
+}
+
+#endif
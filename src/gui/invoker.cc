@@ -20,16 +20,32 @@ void Invoker::invokePlacement()
   // take settings from GUI options
   pc::SASettings sa_set;
   sa_set.gui_up = static_cast<pc::GuiUpdate>(cbb_gui_up->currentIndex());
+  sa_set.init_place = static_cast<pc::InitPlace>(cbb_init_place->currentIndex());
+  sa_set.constructive_t_fact = sb_constructive_t_fact->value();
+  sa_set.skip_anneal = cb_skip_anneal->isChecked();
+  sa_set.finish_mode = static_cast<pc::FinishMode>(cbb_finish_mode->currentIndex());
   sa_set.t_schd = static_cast<pc::TSchd>(cbb_t_schd->currentIndex());
   sa_set.decay_b = sb_decay_b->value();
+  sa_set.lam_its = sb_lam_its->value();
   sa_set.swap_fact = sb_swap_fact->value();
   sa_set.max_its = sb_max_its->value();
+  sa_set.directed_ratio = sb_directed_ratio->value();
+  sa_set.directed_adaptive = cb_directed_adaptive->isChecked();
+  sa_set.block_order = static_cast<pc::BlockOrder>(cbb_block_order->currentIndex());
+  sa_set.p_shift = sb_p_shift->value();
+  sa_set.p_rotate = sb_p_rotate->value();
+  sa_set.p_cluster = sb_p_cluster->value();
   sa_set.max_its_cost_unchanged = sb_max_its_cost_unchanged->value();
   sa_set.use_rw = gb_use_rw->isChecked();
   sa_set.p_upper = sb_p_upper->value();
   sa_set.p_lower = sb_p_lower->value();
   sa_set.min_rw_dim = sb_min_rw_dim->value();
   sa_set.rw_dim_delta = sb_rw_dim_delta->value();
+  sa_set.rejection_free = cb_rejection_free->isChecked();
+  sa_set.multilevel = gb_multilevel->isChecked();
+  sa_set.ml_coarsest_blocks = sb_ml_coarsest_blocks->value();
+  sa_set.ml_refine_swap_fact = sb_ml_refine_swap_fact->value();
+  sa_set.ml_refine_its = sb_ml_refine_its->value();
   sa_set.sanity_check = cb_sanity_check->isChecked();
   sa_set.show_stdout = cb_show_stdout->isChecked();
 
@@ -41,21 +57,65 @@ void Invoker::initGui()
   // get an instance of SASettings with default settings
   pc::SASettings sa_set;
 
-  // map exp decay to 0 and dynamic schedule to 1
+  // map exp decay to 0, dynamic schedule to 1 and modified Lam to 2
   QMap<pc::TSchd, int> tschd_ind;
   tschd_ind[pc::TSchd::ExpDecayTUpdate] = 0;
   tschd_ind[pc::TSchd::StdDevTUpdate] = 1;
+  tschd_ind[pc::TSchd::LamTUpdate] = 2;
 
   // init gui elements
 
+  // initial placement, in the order of pc::InitPlace
+  cbb_init_place = new QComboBox();
+  cbb_init_place->addItem("Random");
+  cbb_init_place->addItem("Current placement");
+  cbb_init_place->addItem("Quadratic wirelength");
+  cbb_init_place->addItem("Recursive min-cut");
+  cbb_init_place->setCurrentIndex(static_cast<int>(sa_set.init_place));
+  cbb_init_place->setToolTip("Initial placements:\n"
+      "Random: blocks scattered uniformly at random\n"
+      "Current placement: continue from the placement shown\n"
+      "Quadratic wirelength: legalized conjugate gradient solution, annealed "
+      "from a reduced temperature\n"
+      "Recursive min-cut: FM bisection into sub-rectangles, annealed from a "
+      "reduced temperature");
+
+  // initial temperature factor for constructive initial placements
+  sb_constructive_t_fact = new QDoubleSpinBox();
+  sb_constructive_t_fact->setSingleStep(0.5);
+  sb_constructive_t_fact->setRange(0.01, 100);
+  sb_constructive_t_fact->setValue(sa_set.constructive_t_fact);
+  sb_constructive_t_fact->setEnabled(sa_set.init_place == pc::InitPlace::QuadraticInit
+      || sa_set.init_place == pc::InitPlace::MinCutInit);
+
+  // only compute the initial placement
+  cb_skip_anneal = new QCheckBox("Skip annealing (initial placement only)");
+  cb_skip_anneal->setChecked(sa_set.skip_anneal);
+
+  // zero temperature finishing phase, in the order of pc::FinishMode
+  cbb_finish_mode = new QComboBox();
+  cbb_finish_mode->addItem("Random T=0 swaps");
+  cbb_finish_mode->addItem("Sliding window permutation");
+  cbb_finish_mode->addItem("Greedy gain buckets");
+  cbb_finish_mode->setCurrentIndex(static_cast<int>(sa_set.finish_mode));
+  cbb_finish_mode->setToolTip("Finishing phases:\n"
+      "Random T=0 swaps: a few more cycles of random moves, only improvements "
+      "are accepted\n"
+      "Sliding window permutation: exhaustively rearrange every 3x2 window "
+      "until no window improves\n"
+      "Greedy gain buckets: repeatedly apply the best improving swap within "
+      "the minimum range window until none is left");
+
   // temperature schedule
   cbb_t_schd = new QComboBox();
   cbb_t_schd->addItem("Exponential decay");
   cbb_t_schd->addItem("Dynamic standard deviation update");
+  cbb_t_schd->addItem("Modified Lam (adaptive moves)");
   cbb_t_schd->setCurrentIndex(tschd_ind[sa_set.t_schd]);
   cbb_t_schd->setToolTip("Temperature schedules:\n"
       "Dynamic: T_new = T_old e^{-0.7 T_old / sigma}\n"
-      "Exp Decay: T_new = beta * T_old");
+      "Exp Decay: T_new = beta * T_old\n"
+      "Modified Lam: T and moves per step follow a target acceptance rate");
 
   // temperature decay factor if exponential decay
   sb_decay_b = new QDoubleSpinBox();
@@ -65,12 +125,54 @@ void Invoker::initGui()
   sb_decay_b->setValue(sa_set.decay_b);
   sb_decay_b->setEnabled(cbb_t_schd->currentIndex() == tschd_ind[pc::TSchd::ExpDecayTUpdate]);
 
+  // modified Lam schedule length
+  sb_lam_its = new QSpinBox();
+  sb_lam_its->setSingleStep(50);
+  sb_lam_its->setRange(10, 100000);
+  sb_lam_its->setValue(sa_set.lam_its);
+  sb_lam_its->setEnabled(cbb_t_schd->currentIndex() == tschd_ind[pc::TSchd::LamTUpdate]);
+
   // swap multiplier
   sb_swap_fact = new QSpinBox();
   sb_swap_fact->setSingleStep(10);
   sb_swap_fact->setRange(0, 1000);
   sb_swap_fact->setValue(sa_set.swap_fact);
 
+  // fraction of moves directed towards connected blocks
+  sb_directed_ratio = new QDoubleSpinBox();
+  sb_directed_ratio->setSingleStep(0.05);
+  sb_directed_ratio->setRange(0, 1);
+  sb_directed_ratio->setValue(sa_set.directed_ratio);
+  sb_directed_ratio->setToolTip("Fraction of moves that target the median "
+      "location of the blocks sharing nets with the moved block");
+  cb_directed_adaptive = new QCheckBox("Scale directed moves by rejection rate");
+  cb_directed_adaptive->setChecked(sa_set.directed_adaptive);
+
+  // order of picking the source blocks of moves
+  cbb_block_order = new QComboBox();
+  cbb_block_order->addItem("Random");
+  cbb_block_order->addItem("Shuffled sweep");
+  cbb_block_order->addItem("Serpentine grid sweep");
+  cbb_block_order->setCurrentIndex(static_cast<int>(sa_set.block_order));
+
+  // compound move probabilities, the remaining moves are swaps
+  QGroupBox *gb_compound = new QGroupBox("Compound Moves");
+  QFormLayout *fl_compound = new QFormLayout();
+  gb_compound->setLayout(fl_compound);
+  sb_p_shift = new QDoubleSpinBox();
+  sb_p_rotate = new QDoubleSpinBox();
+  sb_p_cluster = new QDoubleSpinBox();
+  for (QDoubleSpinBox *sb : {sb_p_shift, sb_p_rotate, sb_p_cluster}) {
+    sb->setSingleStep(0.05);
+    sb->setRange(0, 1);
+  }
+  sb_p_shift->setValue(sa_set.p_shift);
+  sb_p_rotate->setValue(sa_set.p_rotate);
+  sb_p_cluster->setValue(sa_set.p_cluster);
+  fl_compound->addRow("P(shift into empty cell)", sb_p_shift);
+  fl_compound->addRow("P(rotate three cells)", sb_p_rotate);
+  fl_compound->addRow("P(move connected cluster)", sb_p_cluster);
+
   // max iterations
   sb_max_its = new QSpinBox();
   sb_max_its->setSingleStep(100);
@@ -116,6 +218,41 @@ void Invoker::initGui()
   sb_rw_dim_delta->setValue(sa_set.rw_dim_delta);
   fl_rw->addRow("Side length step size", sb_rw_dim_delta);
 
+  // rejection-free sampling once the range window is at its minimum
+  cb_rejection_free = new QCheckBox("Rejection-free at low acceptance");
+  cb_rejection_free->setChecked(sa_set.rejection_free);
+  cb_rejection_free->setToolTip("Once the range window is at its minimum and "
+      "nearly all proposals are rejected, draw accepted moves directly");
+  fl_rw->addRow(cb_rejection_free);
+
+  // multilevel settings
+  gb_multilevel = new QGroupBox("Multilevel");
+  QFormLayout *fl_ml = new QFormLayout();
+  gb_multilevel->setLayout(fl_ml);
+  gb_multilevel->setCheckable(true);
+  gb_multilevel->setChecked(sa_set.multilevel);
+
+  // stop coarsening at this many blocks
+  sb_ml_coarsest_blocks = new QSpinBox();
+  sb_ml_coarsest_blocks->setSingleStep(50);
+  sb_ml_coarsest_blocks->setRange(2, 100000);
+  sb_ml_coarsest_blocks->setValue(sa_set.ml_coarsest_blocks);
+  fl_ml->addRow("Coarsest level blocks", sb_ml_coarsest_blocks);
+
+  // moves factor of the refinement anneals
+  sb_ml_refine_swap_fact = new QDoubleSpinBox();
+  sb_ml_refine_swap_fact->setSingleStep(0.5);
+  sb_ml_refine_swap_fact->setRange(0.1, 1000);
+  sb_ml_refine_swap_fact->setValue(sa_set.ml_refine_swap_fact);
+  fl_ml->addRow("Refinement moves factor", sb_ml_refine_swap_fact);
+
+  // max iterations of the refinement anneals
+  sb_ml_refine_its = new QSpinBox();
+  sb_ml_refine_its->setSingleStep(10);
+  sb_ml_refine_its->setRange(1, 100000);
+  sb_ml_refine_its->setValue(sa_set.ml_refine_its);
+  fl_ml->addRow("Refinement iterations", sb_ml_refine_its);
+
   // GUI update frequency
   cbb_gui_up = new QComboBox();
   cbb_gui_up->addItem("Every swap action");
@@ -139,23 +276,41 @@ void Invoker::initGui()
   connect(cbb_t_schd, QOverload<int>::of(&QComboBox::currentIndexChanged),
       [this, tschd_ind]() {
         sb_decay_b->setEnabled(cbb_t_schd->currentIndex() == tschd_ind[pc::TSchd::ExpDecayTUpdate]);
+        sb_lam_its->setEnabled(cbb_t_schd->currentIndex() == tschd_ind[pc::TSchd::LamTUpdate]);
+      });
+  connect(cbb_init_place, QOverload<int>::of(&QComboBox::currentIndexChanged),
+      [this]() {
+        int ind = cbb_init_place->currentIndex();
+        sb_constructive_t_fact->setEnabled(
+            ind == static_cast<int>(pc::InitPlace::QuadraticInit)
+            || ind == static_cast<int>(pc::InitPlace::MinCutInit));
       });
   connect(pb_run_placement, &QAbstractButton::released, this, &Invoker::invokePlacement);
 
   // add items to layout
   QFormLayout *fl_gen = new QFormLayout();
   fl_gen->addRow("GUI updates", cbb_gui_up);
+  fl_gen->addRow("Initial placement", cbb_init_place);
+  fl_gen->addRow("Constructive T factor", sb_constructive_t_fact);
   fl_gen->addRow("Schedule", cbb_t_schd);
   fl_gen->addRow("Decay factor", sb_decay_b);
+  fl_gen->addRow("Lam schedule steps", sb_lam_its);
   fl_gen->addRow("Num moves factor", sb_swap_fact);
+  fl_gen->addRow("Directed moves ratio", sb_directed_ratio);
+  fl_gen->addRow(cb_directed_adaptive);
+  fl_gen->addRow("Source block order", cbb_block_order);
   fl_gen->addRow("Max iterations", sb_max_its);
   fl_gen->addRow("Exit if cost unchanged for iters", sb_max_its_cost_unchanged);
+  fl_gen->addRow("Finishing phase", cbb_finish_mode);
 
   QVBoxLayout *vl_main = new QVBoxLayout();
   vl_main->addLayout(fl_gen);
+  vl_main->addWidget(cb_skip_anneal);
   vl_main->addWidget(cb_sanity_check);
   vl_main->addWidget(cb_show_stdout);
   vl_main->addWidget(gb_use_rw);
+  vl_main->addWidget(gb_compound);
+  vl_main->addWidget(gb_multilevel);
   vl_main->addWidget(pb_run_placement);
 
   setLayout(vl_main);
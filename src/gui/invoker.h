@@ -39,16 +39,32 @@ namespace gui {
     void initGui();
 
     // Private variables, the names basically correspond to pc::SASettings.
+    QComboBox *cbb_init_place;
+    QDoubleSpinBox *sb_constructive_t_fact;
+    QCheckBox *cb_skip_anneal;
+    QComboBox *cbb_finish_mode;
     QComboBox *cbb_t_schd;
     QDoubleSpinBox *sb_decay_b;
+    QSpinBox *sb_lam_its;
     QSpinBox *sb_swap_fact;
     QSpinBox *sb_max_its;
+    QDoubleSpinBox *sb_directed_ratio;
+    QCheckBox *cb_directed_adaptive;
+    QComboBox *cbb_block_order;
+    QDoubleSpinBox *sb_p_shift;
+    QDoubleSpinBox *sb_p_rotate;
+    QDoubleSpinBox *sb_p_cluster;
     QSpinBox *sb_max_its_cost_unchanged;
     QGroupBox *gb_use_rw;
     QDoubleSpinBox *sb_p_upper;
     QDoubleSpinBox *sb_p_lower;
     QSpinBox *sb_min_rw_dim;
     QSpinBox * sb_rw_dim_delta;
+    QCheckBox *cb_rejection_free;
+    QGroupBox *gb_multilevel;
+    QSpinBox *sb_ml_coarsest_blocks;
+    QDoubleSpinBox *sb_ml_refine_swap_fact;
+    QSpinBox *sb_ml_refine_its;
     QCheckBox *cb_sanity_check;
     QComboBox *cbb_gui_up;
     QCheckBox *cb_show_stdout;
@@ -15,7 +15,7 @@ TelemetryChart::TelemetryChart(QWidget *parent)
   initGui();
 }
 
-void TelemetryChart::addTelemetry(int cost, float T, float p_accept, int rw_dim)
+void TelemetryChart::addTelemetry(qint64 cost, float T, float p_accept, int rw_dim)
 {
   int x_step = std::max(cost_series->count(), T_series->count());
   // update values
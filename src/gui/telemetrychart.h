@@ -26,7 +26,7 @@ namespace gui {
     TelemetryChart(QWidget *parent=nullptr);
 
     //! Add telemetry info to chart (assume invalid if negative).
-    void addTelemetry(int cost, float T, float p_accept, int rw_dim);
+    void addTelemetry(qint64 cost, float T, float p_accept, int rw_dim);
 
     //! Clear telemetries.
     void clearTelemetries();
@@ -54,7 +54,7 @@ namespace gui {
     QLabel *l_curr_T;         //!< Label of current temperature.
     QLabel *l_curr_cost;      //!< Label of current cost.
     float y_max_buf=1.1;      //!< Percentage buffer to add at the top of y axes.
-    int max_cost=-1;          //!< Maximum cost seen.
+    qint64 max_cost=-1;       //!< Maximum cost seen.
     float max_T=-1;           //!< Maximum temperature seen.
     float max_p_accept=-1;    //!< Maximum acceptance probability seen.
     int max_rw_dim=-1;        //!< Maximum range window dimension seen.
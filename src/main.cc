@@ -11,6 +11,7 @@
 #include <QDebug>
 
 #include "benchmarker.h"
+#include "netlistgen.h"
 #include "gui/mainwindow.h"
 
 int main(int argc, char **argv) {
@@ -33,8 +34,47 @@ int main(int argc, char **argv) {
       " writes to out.json if unspecified.", "path"});
   parser.addOption({"repeat", "Repeat each benchmark for the specified number "
       "of times. Defaults to 10 if unspecified.", "repeat"});
+  parser.addOption({"generate", "Generator mode. Write a synthetic netlist with "
+      "Rent's rule locality to <path> in the problem file format.", "path"});
+  parser.addOption({"blocks", "Number of blocks in generated netlists. Defaults "
+      "to 10000 if unspecified.", "blocks"});
+  parser.addOption({"seed", "Seed for generated netlists. Defaults to 513 if "
+      "unspecified.", "seed"});
+  parser.addOption({"scaling", "Scaling benchmark mode. Place generated "
+      "netlists of increasing sizes and record moves/sec, memory and cost."});
+  parser.addOption({"sizes", "Comma separated block counts for the scaling "
+      "benchmark. Defaults to 10000,30000,100000 if unspecified.", "sizes"});
+  parser.addOption({"checkpoint", "Checkpointed mode. Place in_file with the "
+      "benchmark settings without GUI, writing the annealing state to <path> "
+      "every checkpoint_its steps.", "path"});
+  parser.addOption({"checkpoint_its", "Steps between checkpoints. Defaults to "
+      "10 if unspecified.", "its"});
+  parser.addOption({"resume", "Continue the checkpointed placement of in_file "
+      "from the checkpoint at <path>, with the benchmark settings it was "
+      "started with. Checkpoints keep being written to <path> unless "
+      "--checkpoint is given.", "path"});
+  parser.addOption({"eco", "ECO mode. Place in_file without GUI starting from "
+      "the placement file at <path>, written for an earlier version of the "
+      "netlist, and only anneal around the blocks that had to be inserted.",
+      "path"});
+  parser.addOption({"placement_out", "Write the final placement to <path>. "
+      "Places in_file with the benchmark settings without GUI unless the "
+      "checkpointed or ECO mode is given.", "path"});
   parser.process(app);
 
+  // generator mode routine
+  if (parser.isSet("generate")) {
+    cli::GenSettings gen_settings;
+    if (parser.isSet("blocks")) {
+      gen_settings.n_blocks = parser.value("blocks").toInt();
+    }
+    if (parser.isSet("seed")) {
+      gen_settings.seed = parser.value("seed").toUInt();
+    }
+    cli::NetlistGenerator gen(gen_settings);
+    return gen.writeToFile(parser.value("generate")) ? 0 : 1;
+  }
+
   // benchmark mode routine (don't show GUI if benchmarking)
   bool benchmark_mode = parser.isSet("benchmark");
   if (benchmark_mode) {
@@ -50,8 +90,46 @@ int main(int argc, char **argv) {
     return 0; 
   }
 
-  // get input file path
+  // scaling benchmark mode routine
+  if (parser.isSet("scaling")) {
+    QString out_name = parser.isSet("json_out") ? parser.value("json_out") : "out.json";
+    QString set_name = parser.isSet("bench_settings_in") ? 
+      parser.value("bench_settings_in") : "";
+    int repeat = parser.isSet("repeat") ? parser.value("repeat").toInt() : 1;
+    unsigned int seed = parser.isSet("seed") ? parser.value("seed").toUInt() : 513;
+    QList<int> sizes;
+    QString sizes_str = parser.isSet("sizes") ? parser.value("sizes") : "10000,30000,100000";
+    for (const QString &size_str : sizes_str.split(",")) {
+      sizes.append(size_str.toInt());
+    }
+    cli::Benchmarker bm(out_name, repeat, set_name);
+    bm.runScalingSuite(sizes, seed);
+    return 0;
+  }
+
+  // single, checkpointed and ECO placement routines
   const QStringList args = parser.positionalArguments();
+  if (parser.isSet("checkpoint") || parser.isSet("resume") || parser.isSet("eco")
+      || parser.isSet("placement_out")) {
+    if (args.empty()) {
+      qDebug() << "Placement without GUI requires an input file.";
+      return 1;
+    }
+    QString out_name = parser.isSet("json_out") ? parser.value("json_out") : "out.json";
+    QString set_name = parser.isSet("bench_settings_in") ? 
+      parser.value("bench_settings_in") : "";
+    cli::Benchmarker bm(out_name, 1, set_name);
+    bm.setPlacementOutPath(parser.value("placement_out"));
+    if (parser.isSet("eco")) {
+      return bm.runEco(args[0], parser.value("eco")) ? 0 : 1;
+    }
+    QString resume_path = parser.value("resume");
+    QString cp_path = parser.isSet("checkpoint") ? parser.value("checkpoint") : resume_path;
+    int cp_its = parser.isSet("checkpoint_its") ? parser.value("checkpoint_its").toInt() : 10;
+    return bm.runCheckpointed(args[0], cp_path, cp_its, resume_path) ? 0 : 1;
+  }
+
+  // get input file path
   QString in_path;
   if (!args.empty()) {
     in_path = args[0];
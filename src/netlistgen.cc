@@ -0,0 +1,178 @@
+// @file:     netlistgen.cc
+// @author:   Samuel Ng
+// @created:  2021-02-20
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the synthetic netlist generator.
+
+#include <algorithm>
+#include <numeric>
+#include <math.h>
+#include "netlistgen.h"
+
+using namespace cli;
+
+NetlistGenerator::NetlistGenerator(const GenSettings &gen_settings)
+  : gs(gen_settings), mt(gen_settings.seed)
+{
+  gs.n_blocks = std::max(gs.n_blocks, 2);
+  gs.max_degree = std::max(std::min(gs.max_degree, gs.n_blocks), 2);
+
+  // truncated power law for net degrees, index 0 corresponds to degree 2
+  double deg_total = 0;
+  for (int deg=2; deg<=gs.max_degree; deg++) {
+    deg_total += pow(deg, -gs.degree_exp);
+    deg_cdf.push_back(deg_total);
+  }
+
+  // number of quadtree levels required to cover all blocks
+  while (pow(4, n_levels) < gs.n_blocks) {
+    n_levels++;
+  }
+}
+
+void NetlistGenerator::generate()
+{
+  int n_blocks = gs.n_blocks;
+
+  // chip dimensions that fit all blocks at the requested utilization
+  int n_sites = std::ceil(n_blocks / std::max(std::min(gs.utilization, 1.f), 0.01f));
+  ny = std::max((int)std::ceil(sqrt(n_sites)), 1);
+  nx = std::ceil((float)n_sites / ny);
+
+  // generate nets over virtual quadtree positions
+  nets.clear();
+  int n_nets = std::max((int)std::round(n_blocks * gs.nets_per_block), 1);
+  QVector<bool> connected(n_blocks, false);
+  for (int net_id=0; net_id<n_nets; net_id++) {
+    int degree = drawDegree();
+    int lvl = drawLevel(degree);
+    QList<int> conn_blocks = pickFromCluster(lvl, drawIndex(n_blocks), degree);
+    for (int pos : conn_blocks) {
+      connected[pos] = true;
+    }
+    nets.append(conn_blocks);
+  }
+
+  // connect leftover blocks to a neighbor in their lowest level cluster
+  for (int pos=0; pos<n_blocks; pos++) {
+    if (connected[pos]) {
+      continue;
+    }
+    QList<int> picked = pickFromCluster(1, pos, 2);
+    QList<int> conn_blocks;
+    conn_blocks << pos << ((picked[0] != pos) ? picked[0] : picked[1]);
+    connected[conn_blocks[0]] = connected[conn_blocks[1]] = true;
+    nets.append(conn_blocks);
+  }
+
+  // shuffle block IDs so that locality is not encoded in the numbering
+  QVector<int> perm(n_blocks);
+  std::iota(perm.begin(), perm.end(), 0);
+  for (int i=n_blocks-1; i>0; i--) {
+    std::swap(perm[i], perm[drawIndex(i+1)]);
+  }
+  for (QList<int> &net : nets) {
+    for (int &bid : net) {
+      bid = perm[bid];
+    }
+  }
+
+  generated = true;
+}
+
+bool NetlistGenerator::writeToFile(const QString &f_path)
+{
+  if (!generated) {
+    generate();
+  }
+
+  QFile f_out(f_path);
+  if (!f_out.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    qWarning() << "Unable to open" << f_path << "for writing.";
+    return false;
+  }
+
+  // first line is "n_blocks n_nets ny nx", then one net per line
+  QTextStream out(&f_out);
+  out << gs.n_blocks << " " << nets.size() << " " << ny << " " << nx << "\n";
+  for (const QList<int> &net : nets) {
+    out << net.size();
+    for (int bid : net) {
+      out << " " << bid;
+    }
+    out << "\n";
+  }
+  f_out.close();
+  return true;
+}
+
+int NetlistGenerator::drawIndex(int n)
+{
+  // scale a 32-bit draw to [0, n), the bias is below n / 2^32
+  return (int)(((quint64)mt() * n) >> 32);
+}
+
+int NetlistGenerator::drawWeighted(const std::vector<double> &cdf)
+{
+  double u = mt() / 4294967296. * cdf.back();
+  int ind = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+  return std::min(ind, (int)cdf.size() - 1);
+}
+
+int NetlistGenerator::drawDegree()
+{
+  return drawWeighted(deg_cdf) + 2;
+}
+
+int NetlistGenerator::drawLevel(int degree)
+{
+  // lowest level with clusters large enough to host the net
+  int lvl_min = 1;
+  while (pow(4, lvl_min) < degree && lvl_min < n_levels) {
+    lvl_min++;
+  }
+  // Rent's rule: nets spanning clusters of size B occur in proportion to B^(p-1)
+  std::vector<double> lvl_cdf;
+  double lvl_total = 0;
+  for (int lvl=lvl_min; lvl<=n_levels; lvl++) {
+    lvl_total += pow(4, lvl * (gs.rent_p - 1));
+    lvl_cdf.push_back(lvl_total);
+  }
+  return lvl_min + drawWeighted(lvl_cdf);
+}
+
+QList<int> NetlistGenerator::pickFromCluster(int lvl, int pos, int degree)
+{
+  // find the cluster bounds, go up a level if the (truncated) cluster is too
+  // small to host the requested degree
+  int start, count;
+  do {
+    int size = pow(4, lvl);
+    start = (pos / size) * size;
+    count = std::min(start + size, gs.n_blocks) - start;
+    lvl++;
+  } while (count < degree);
+
+  QList<int> picked;
+  if (degree * 4 <= count) {
+    // sparse pick by rejection
+    QSet<int> picked_set;
+    while (picked.size() < degree) {
+      int bid = start + drawIndex(count);
+      if (!picked_set.contains(bid)) {
+        picked_set.insert(bid);
+        picked.append(bid);
+      }
+    }
+  } else {
+    // dense pick by partial Fisher-Yates shuffle
+    QVector<int> members(count);
+    std::iota(members.begin(), members.end(), start);
+    for (int i=0; i<degree; i++) {
+      std::swap(members[i], members[i + drawIndex(count - i)]);
+      picked.append(members[i]);
+    }
+  }
+  return picked;
+}
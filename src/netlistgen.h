@@ -0,0 +1,94 @@
+/*!
+  \file netlistgen.h
+  \brief Synthetic netlist generator for scalability testing.
+  \author Samuel Ng
+  \date 2021-02-20 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _CLI_NETLISTGEN_H_
+#define _CLI_NETLISTGEN_H_
+
+#include <QtWidgets>
+#include <random>
+
+namespace cli {
+
+  //! Synthetic netlist generation settings.
+  struct GenSettings
+  {
+    int n_blocks=10000;         //!< Number of blocks to generate.
+    float utilization=0.8;      //!< Fraction of chip sites occupied by blocks.
+    float nets_per_block=0.95;  //!< Number of nets generated per block.
+    float rent_p=0.6;           //!< Rent exponent controlling net locality.
+    float degree_exp=2.5;       //!< Power law exponent of the net degree distribution.
+    int max_degree=256;         //!< Maximum net degree.
+    unsigned int seed=513;      //!< RNG seed, same seed gives the same netlist with any standard library.
+  };
+
+  /*! \brief Generate large synthetic netlists in the problem file format.
+   *
+   * Blocks are laid out on a virtual quadtree such that each level-L cluster
+   * holds 4^L consecutive blocks. Each net first draws its degree from a
+   * truncated power law, then draws the hierarchy level it spans with weight
+   * 4^(L*(p-1)) (which gives the T = t*B^p terminal scaling of Rent's rule),
+   * and finally picks its pins from a random cluster at that level. Block IDs
+   * are shuffled at the end so that locality is not trivially encoded in IDs.
+   * All draws are made from the raw Mersenne Twister output rather than the
+   * standard library distributions, whose algorithms differ between 
+   * implementations, so that a seed gives the same netlist everywhere.
+   */
+  class NetlistGenerator
+  {
+  public:
+    //! Constructor taking the generation settings.
+    NetlistGenerator(const GenSettings &gen_settings);
+
+    //! Generate the netlist. Called by writeToFile if not already generated.
+    void generate();
+
+    //! Write the netlist to the specified path in the problem file format.
+    bool writeToFile(const QString &f_path);
+
+    //! Return the generated nets.
+    const QVector<QList<int>> &getNets() const {return nets;}
+
+    //! Return nx.
+    int dimX() const {return nx;}
+
+    //! Return ny.
+    int dimY() const {return ny;}
+
+  private:
+
+    //! Draw an integer in [0, n) uniformly.
+    int drawIndex(int n);
+
+    //! Draw an index of the cumulative weights cdf in proportion to its 
+    //! weight, by inverting the cumulative distribution.
+    int drawWeighted(const std::vector<double> &cdf);
+
+    //! Draw the degree of the next net.
+    int drawDegree();
+
+    //! Draw the hierarchy level spanned by a net with the specified degree.
+    int drawLevel(int degree);
+
+    //! Pick the specified number of distinct blocks from the cluster of
+    //! hierarchy level lvl containing virtual block position pos.
+    QList<int> pickFromCluster(int lvl, int pos, int degree);
+
+    // Private variables
+    GenSettings gs;             //!< Generation settings.
+    std::mt19937 mt;            //!< Mersenne Twister PRNG, seeded by gs.seed.
+    std::vector<double> deg_cdf;  //!< Cumulative weights of the net degrees (offset by 2).
+    int n_levels=0;             //!< Number of hierarchy levels.
+    int nx=0;                   //!< Generated chip dimension in x.
+    int ny=0;                   //!< Generated chip dimension in y.
+    bool generated=false;       //!< Whether the netlist has been generated.
+    QVector<QList<int>> nets;   //!< Generated nets.
+  };
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+// @file:     checkpoint.cc
+// @author:   Samuel Ng
+// @created:  2021-03-02
+// @license:  GNU LGPL v3
+//
+// @desc:     Binary reading and writing of annealing checkpoints.
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include "checkpoint.h"
+
+// file signature ("SPCK") and format version
+#define CHECKPOINT_MAGIC 0x5350434b
+#define CHECKPOINT_VERSION 4
+
+using namespace pc;
+
+bool AnnealCheckpoint::write(const QString &path) const
+{
+  QString tmp_path = path + ".tmp";
+  QFile file(tmp_path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Unable to open" << tmp_path << "for writing.";
+    return false;
+  }
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << (quint32)CHECKPOINT_MAGIC << (quint32)CHECKPOINT_VERSION;
+  out << nx << ny << n_blocks << n_nets;
+  out << block_locs << cost << init_cost;
+  out << T << init_T << rw_dim << iterations << moves
+    << iterations_cost_unchanged << main_done << abs_zero_cycles
+    << directed_ratio << approx << rejection_free;
+  out << sweep_order << rng_state << rf_deltas << rf_stale << rf_blk_stale;
+  out << best_cost << best_locs << time_budget_ms << elapsed_ms 
+    << anneal_start_ms;
+
+  // a short write, e.g. to a full disk, must not replace the previous 
+  // checkpoint
+  if (out.status() != QDataStream::Ok || !file.flush()) {
+    qWarning() << "Unable to write" << tmp_path;
+    file.close();
+    QFile::remove(tmp_path);
+    return false;
+  }
+  file.close();
+
+  // replace the previous checkpoint only once this one is complete
+  QFile::remove(path);
+  if (!QFile::rename(tmp_path, path)) {
+    qWarning() << "Unable to move" << tmp_path << "to" << path;
+    return false;
+  }
+  return true;
+}
+
+bool AnnealCheckpoint::read(const QString &path)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Unable to open" << path << "for reading.";
+    return false;
+  }
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic, version;
+  in >> magic >> version;
+  if (in.status() != QDataStream::Ok || magic != CHECKPOINT_MAGIC
+      || version != CHECKPOINT_VERSION) {
+    qWarning() << path << "is not a checkpoint of this version.";
+    return false;
+  }
+  in >> nx >> ny >> n_blocks >> n_nets;
+  in >> block_locs >> cost >> init_cost;
+  in >> T >> init_T >> rw_dim >> iterations >> moves
+    >> iterations_cost_unchanged >> main_done >> abs_zero_cycles
+    >> directed_ratio >> approx >> rejection_free;
+  in >> sweep_order >> rng_state >> rf_deltas >> rf_stale >> rf_blk_stale;
+  in >> best_cost >> best_locs >> time_budget_ms >> elapsed_ms 
+    >> anneal_start_ms;
+  if (in.status() != QDataStream::Ok || block_locs.size() != n_blocks) {
+    qWarning() << path << "is truncated or corrupt.";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,80 @@
+/*!
+  \file checkpoint.h
+  \brief Annealing state snapshots for checkpointing and resuming placements.
+  \author Samuel Ng
+  \date 2021-03-02 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_CHECKPOINT_H_
+#define _PC_CHECKPOINT_H_
+
+#include <QByteArray>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+namespace pc {
+
+  /*! \brief State of an anneal between two temperature steps.
+   *
+   * Holds everything the annealer carries from one step to the next: the
+   * placement, the schedule position, the PRNG state, the cached deltas of
+   * the rejection-free sampler, the best placement kept so far and the time
+   * spent of the time budget. Continuing from a checkpoint with the settings
+   * of the checkpointed run makes the same moves as the run that wrote it.
+   * Files are written in a versioned binary format to a temporary file that
+   * replaces the previous checkpoint only once it is completely written, so
+   * that a run preempted or failing while writing leaves the last complete
+   * checkpoint.
+   */
+  struct AnnealCheckpoint
+  {
+    // problem dimensions, checked when resuming
+    int nx=0;                 //!< Chip width.
+    int ny=0;                 //!< Chip height.
+    int n_blocks=0;           //!< Number of blocks.
+    int n_nets=0;             //!< Number of nets.
+
+    // placement
+    QVector<QPair<int,int>> block_locs; //!< Cell of each block.
+    qint64 cost=-1;           //!< Cost of the placement.
+    qint64 init_cost=-1;      //!< Cost of the initial placement of the run.
+
+    // schedule
+    float T=0;                //!< Temperature of the next step.
+    float init_T=0;           //!< Temperature of the first step.
+    int rw_dim=0;             //!< Range window dimension of the next step.
+    int iterations=0;         //!< Steps made.
+    qint64 moves=0;           //!< Moves attempted.
+    int iterations_cost_unchanged=0;  //!< Steps the cost has been unchanged for.
+    bool main_done=false;     //!< Whether the zero temperature steps have begun.
+    int abs_zero_cycles=0;    //!< Zero temperature steps left.
+    float directed_ratio=0;   //!< Current fraction of directed moves.
+    bool approx=false;        //!< Whether move deltas are still approximate.
+    bool rejection_free=false;  //!< Whether rejection-free sampling has begun.
+
+    // move generation
+    QVector<int> sweep_order; //!< Block permutation of the shuffled sweep.
+    QByteArray rng_state;     //!< Textual state of the Mersenne Twister.
+    QVector<qint64> rf_deltas;  //!< Cached cost delta of each rejection-free candidate.
+    QVector<bool> rf_stale;   //!< Whether each cached delta may be out of date.
+    QVector<bool> rf_blk_stale; //!< Whether all candidates of each block are stale.
+
+    // best placement and time budget
+    qint64 best_cost=-1;      //!< Lowest cost at the end of a step so far.
+    QVector<QPair<int,int>> best_locs;  //!< Cell of each block in the best placement, empty if not kept.
+    int time_budget_ms=0;     //!< Time budget of the run, 0 for none.
+    qint64 elapsed_ms=0;      //!< Time spent of the budget.
+    qint64 anneal_start_ms=0; //!< Time the first step started at.
+
+    //! Write the checkpoint to the file at path, return whether successful.
+    bool write(const QString &path) const;
+
+    //! Read a checkpoint written by write, return whether successful.
+    bool read(const QString &path);
+  };
+
+}
+
+#endif
@@ -0,0 +1,179 @@
+// @file:     detailed.cc
+// @author:   Samuel Ng
+// @created:  2021-02-24
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the sliding window detailed placer.
+
+#include <algorithm>
+#include "detailed.h"
+
+// largest supported window, 8! arrangements per window is already a lot
+#define MAX_WINDOW_CELLS 8
+
+using namespace pc;
+
+DetailedPlacer::DetailedPlacer(sp::Chip *chip)
+  : chip(chip)
+{
+  net_changed.fill(0, chip->numNets());
+  net_stamp.fill(0, chip->numNets());
+}
+
+qint64 DetailedPlacer::refine(int win_w, int win_h, int max_passes)
+{
+  win_w = std::max(std::min(win_w, chip->dimX()), 1);
+  win_h = std::max(std::min(win_h, chip->dimY()), 1);
+  while (win_w * win_h > MAX_WINDOW_CELLS) {
+    (win_w > win_h) ? win_w-- : win_h--;
+  }
+
+  switch (chip->costModel()) {
+    case sp::CostModel::WeightedHPWL:
+      return refinePasses<sp::WeightedHPWLModel>(win_w, win_h, max_passes);
+    case sp::CostModel::SquaredDist:
+      return refinePasses<sp::SquaredDistModel>(win_w, win_h, max_passes);
+    case sp::CostModel::Star:
+      return refinePasses<sp::StarModel>(win_w, win_h, max_passes);
+    default:
+      return refinePasses<sp::HPWLModel>(win_w, win_h, max_passes);
+  }
+}
+
+template<class Model>
+qint64 DetailedPlacer::refinePasses(int win_w, int win_h, int max_passes)
+{
+  qint64 total_delta = 0;
+  for (int pass=1; pass<=max_passes; pass++) {
+    qint64 pass_delta = 0;
+    for (int y0=0; y0+win_h<=chip->dimY(); y0++) {
+      for (int x0=0; x0+win_w<=chip->dimX(); x0++) {
+        pass_delta += optimizeWindow<Model>(x0, y0, win_w, win_h, pass);
+      }
+    }
+    total_delta += pass_delta;
+    if (pass_delta == 0) {
+      break;
+    }
+  }
+  return total_delta;
+}
+
+template<class Model>
+qint64 DetailedPlacer::optimizeWindow(int x0, int y0, int win_w, int win_h, int pass)
+{
+  sp::Graph *graph = chip->getGraph();
+  int n_cells = win_w * win_h;
+
+  // window contents, local block indices are assigned in cell order
+  QPair<int,int> cells[MAX_WINDOW_CELLS];
+  int local_bids[MAX_WINDOW_CELLS];
+  int content[MAX_WINDOW_CELLS];  // local block index at each cell, -1 if empty
+  int n_local = 0;
+  for (int c=0; c<n_cells; c++) {
+    cells[c] = qMakePair(x0 + c % win_w, y0 + c / win_w);
+    int bid = chip->blockIdAt(cells[c]);
+    content[c] = (bid == -1) ? -1 : n_local;
+    if (bid != -1) {
+      local_bids[n_local++] = bid;
+    }
+  }
+  if (n_local == 0 || (n_local == 1 && n_local == n_cells)) {
+    return 0;
+  }
+
+  // collect unique nets, skip the window if none changed since the last pass
+  stamp++;
+  QVector<int> nets;
+  bool any_changed = (pass == 1);
+  for (int i=0; i<n_local; i++) {
+    for (int net_id : graph->blockNets(local_bids[i])) {
+      if (net_stamp[net_id] != stamp) {
+        net_stamp[net_id] = stamp;
+        nets.append(net_id);
+        any_changed |= (net_changed[net_id] >= pass - 1);
+      }
+    }
+  }
+  if (!any_changed) {
+    return 0;
+  }
+
+  // accumulated pins outside the window and local indices of the pins 
+  // inside, per net
+  struct WinNet {typename Model::Acc outside; int weight, n_pins; QVector<int> inside;};
+  QVector<WinNet> win_nets(nets.size());
+  for (int n=0; n<nets.size(); n++) {
+    WinNet &wn = win_nets[n];
+    const QList<int> &net = graph->getNet(nets[n]);
+    wn.weight = graph->netWeight(nets[n]);
+    wn.n_pins = net.size();
+    for (int bid : net) {
+      int local = std::find(local_bids, local_bids + n_local, bid) - local_bids;
+      if (local < n_local) {
+        wn.inside.append(local);
+      } else {
+        QPair<int,int> loc = chip->blockLoc(bid);
+        wn.outside.add(loc.first, loc.second);
+      }
+    }
+  }
+
+  // cost of the nets given the cell of each local block
+  int block_cell[MAX_WINDOW_CELLS];
+  auto arrangementCost = [&]() {
+    qint64 cost = 0;
+    for (const WinNet &wn : win_nets) {
+      typename Model::Acc acc = wn.outside;
+      for (int local : wn.inside) {
+        const QPair<int,int> &loc = cells[block_cell[local]];
+        acc.add(loc.first, loc.second);
+      }
+      cost += wn.weight * Model::cost(acc, wn.n_pins);
+    }
+    return cost;
+  };
+  auto setBlockCells = [&](const int *arr) {
+    for (int c=0; c<n_cells; c++) {
+      if (arr[c] != -1) {
+        block_cell[arr[c]] = c;
+      }
+    }
+  };
+
+  // enumerate all distinct arrangements, next_permutation wraps around so 
+  // stepping from the current arrangement visits every other one exactly once
+  setBlockCells(content);
+  qint64 orig_cost = arrangementCost();
+  qint64 best_cost = orig_cost;
+  int best[MAX_WINDOW_CELLS];
+  std::copy(content, content + n_cells, best);
+  int perm[MAX_WINDOW_CELLS];
+  std::copy(content, content + n_cells, perm);
+  while (true) {
+    std::next_permutation(perm, perm + n_cells);
+    if (std::equal(perm, perm + n_cells, content)) {
+      break;
+    }
+    setBlockCells(perm);
+    qint64 cost = arrangementCost();
+    n_evals++;
+    if (cost < best_cost) {
+      best_cost = cost;
+      std::copy(perm, perm + n_cells, best);
+    }
+  }
+
+  if (best_cost == orig_cost) {
+    return 0;
+  }
+
+  // apply the best arrangement and mark its nets as changed
+  for (int c=0; c<n_cells; c++) {
+    chip->setLocBlock(cells[c], (best[c] == -1) ? -1 : local_bids[best[c]]);
+  }
+  for (int net_id : nets) {
+    net_changed[net_id] = pass;
+  }
+  return best_cost - orig_cost;
+}
@@ -0,0 +1,60 @@
+/*!
+  \file detailed.h
+  \brief Sliding window detailed placement.
+  \author Samuel Ng
+  \date 2021-02-24 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_DETAILED_H_
+#define _PC_DETAILED_H_
+
+#include "spatial.h"
+
+namespace pc {
+
+  /*! \brief Deterministic detailed placement by exhaustive window permutation.
+   *
+   * A small window is slid over every position of the chip. For each window,
+   * all distinct arrangements of its blocks (and empty cells) are enumerated
+   * and the cheapest one is applied. Nets only need the pins outside of the 
+   * window to be accumulated once per window, after which each arrangement 
+   * only visits the pins inside. Passes are repeated until no window 
+   * improves, and windows whose nets did not change during the previous pass
+   * are skipped.
+   */
+  class DetailedPlacer
+  {
+  public:
+    //! Constructor taking the chip to be refined.
+    DetailedPlacer(sp::Chip *chip);
+
+    //! Refine the placement with the specified window dimensions and return
+    //! the (non-positive) cost change. Stops after max_passes passes.
+    qint64 refine(int win_w=3, int win_h=2, int max_passes=100);
+
+    //! Return the number of arrangements evaluated so far.
+    long evaluations() const {return n_evals;}
+
+  private:
+
+    //! Run refinement passes under the cost model policy until no window 
+    //! improves. Return the cost change.
+    template<class Model> qint64 refinePasses(int win_w, int win_h, int max_passes);
+
+    //! Find and apply the best arrangement of the window with the top left 
+    //! cell at (x0, y0) under the cost model policy. Return the cost change.
+    template<class Model> 
+    qint64 optimizeWindow(int x0, int y0, int win_w, int win_h, int pass);
+
+    // Private variables
+    sp::Chip *chip;           //!< The chip to be refined.
+    long n_evals=0;           //!< Number of arrangements evaluated.
+    QVector<int> net_changed; //!< Last pass in which each net changed.
+    QVector<int> net_stamp;   //!< Per-net marker for collecting unique nets.
+    int stamp=0;              //!< Current marker value.
+  };
+
+}
+
+#endif
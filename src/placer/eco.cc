@@ -0,0 +1,154 @@
+// @file:     eco.cc
+// @author:   Samuel Ng
+// @created:  2021-03-03
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the ECO placer.
+
+#include <algorithm>
+#include "eco.h"
+
+// nets larger than this are ignored when locating inserted blocks and when
+// collecting the blocks moved around them
+#define MAX_ECO_NET_SIZE 32
+
+using namespace pc;
+
+EcoPlacer::EcoPlacer(sp::Chip *chip)
+  : chip(chip)
+{}
+
+bool EcoPlacer::loadPlacement(const QString &f_path)
+{
+  QVector<QPair<int,int>> locs;
+  if (!chip->isInitialized() || !chip->readPlacement(f_path, locs)) {
+    return false;
+  }
+
+  // surviving blocks keep their old cells, the first one claiming a cell
+  // keeps it if the old placement has several blocks on it
+  chip->initEmptyPlacements();
+  inserted.clear();
+  placed.fill(false, chip->numBlocks());
+  for (int bid=0; bid<chip->numBlocks(); bid++) {
+    if (locs[bid].first >= 0 && chip->blockIdAt(locs[bid]) < 0) {
+      chip->setLocBlock(locs[bid], bid);
+      placed[bid] = true;
+    } else {
+      inserted.append(bid);
+    }
+  }
+
+  // the remaining blocks go next to their placed neighbours
+  for (int bid : inserted) {
+    QPair<int,int> cell = nearestFreeCell(neighbourMedian(bid));
+    if (cell.first < 0) {
+      qWarning() << "No free cell left for block" << bid;
+      return false;
+    }
+    chip->setLocBlock(cell, bid);
+    placed[bid] = true;
+  }
+  chip->setCost(chip->calcCost());
+  return true;
+}
+
+SAResults EcoPlacer::refine(const SASettings &t_sa_settings)
+{
+  if (inserted.isEmpty()) {
+    SAResults results;
+    results.cost = results.init_cost = chip->getCost();
+    results.iterations = 0;
+    results.moves = 0;
+    return results;
+  }
+
+  // the inserted blocks and their neighbours are the ones moved
+  sp::Graph *graph = chip->getGraph();
+  QVector<bool> is_source(chip->numBlocks(), false);
+  QVector<int> sources;
+  for (int bid : inserted) {
+    if (!is_source[bid]) {
+      is_source[bid] = true;
+      sources.append(bid);
+    }
+    for (int net_id : graph->blockNets(bid)) {
+      const QList<int> &net = graph->getNet(net_id);
+      if (net.size() > MAX_ECO_NET_SIZE) {
+        continue;
+      }
+      for (int conn_bid : net) {
+        if (!is_source[conn_bid]) {
+          is_source[conn_bid] = true;
+          sources.append(conn_bid);
+        }
+      }
+    }
+  }
+
+  // start cold with a small range window, leave out the features that work
+  // on the whole chip, and never return worse than the inserted placement
+  SASettings sa_settings = t_sa_settings;
+  sa_settings.keep_best = true;
+  sa_settings.init_place = InitPlace::ExistingInit;
+  sa_settings.init_t_fact = sa_settings.ml_refine_t_fact;
+  sa_settings.init_rw_dim = sa_settings.constructive_rw_dim;
+  sa_settings.finish_mode = FinishMode::RandomFinish;
+  sa_settings.rejection_free = false;
+  sa_settings.multilevel = false;
+  sa_settings.approx_net_size = 0;
+  sa_settings.sanity_check = false;
+  Placer placer(chip);
+  placer.setSourceBlocks(sources);
+  return placer.runPlacer(sa_settings);
+}
+
+QPair<int,int> EcoPlacer::neighbourMedian(int block_id)
+{
+  sp::Graph *graph = chip->getGraph();
+  QVector<int> xs, ys;
+  for (int net_id : graph->blockNets(block_id)) {
+    const QList<int> &net = graph->getNet(net_id);
+    if (net.size() > MAX_ECO_NET_SIZE) {
+      continue;
+    }
+    for (int conn_bid : net) {
+      if (conn_bid != block_id && placed[conn_bid]) {
+        QPair<int,int> loc = chip->blockLoc(conn_bid);
+        xs.append(loc.first);
+        ys.append(loc.second);
+      }
+    }
+  }
+  if (xs.isEmpty()) {
+    return qMakePair(chip->dimX() / 2, chip->dimY() / 2);
+  }
+  std::nth_element(xs.begin(), xs.begin() + xs.size() / 2, xs.end());
+  std::nth_element(ys.begin(), ys.begin() + ys.size() / 2, ys.end());
+  return qMakePair(xs[xs.size() / 2], ys[ys.size() / 2]);
+}
+
+QPair<int,int> EcoPlacer::nearestFreeCell(const QPair<int,int> &target)
+{
+  int nx = chip->dimX();
+  int ny = chip->dimY();
+  // search rings of growing radius around the target
+  for (int r=0; r<std::max(nx, ny); r++) {
+    for (int dy=-r; dy<=r; dy++) {
+      int y = target.second + dy;
+      if (y < 0 || y >= ny) {
+        continue;
+      }
+      // the top and bottom rows of the ring are whole, the others only have
+      // their two end cells
+      int step = (dy == -r || dy == r) ? 1 : std::max(2 * r, 1);
+      for (int dx=-r; dx<=r; dx+=step) {
+        int x = target.first + dx;
+        if (x >= 0 && x < nx && chip->blockIdAt(x, y) < 0) {
+          return qMakePair(x, y);
+        }
+      }
+    }
+  }
+  return qMakePair(-1, -1);
+}
@@ -0,0 +1,69 @@
+/*!
+  \file eco.h
+  \brief Incremental re-placement of a changed netlist from an earlier placement.
+  \author Samuel Ng
+  \date 2021-03-03 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_ECO_H_
+#define _PC_ECO_H_
+
+#include "placer.h"
+
+namespace pc {
+
+  /*! \brief Engineering change order (ECO) placement.
+   *
+   * Starts from the placement of an earlier version of the netlist: blocks
+   * that survived the change keep their old cells, and new blocks as well as
+   * blocks whose old cell is gone or taken are inserted at the free cell
+   * nearest to the median of their placed neighbours. The anneal that
+   * follows starts cold with a small range window and only draws the moves
+   * of the inserted blocks and their neighbours. The blocks they are 
+   * swapped with move as well, but only within the range window, so that 
+   * the anneal stays local and its run time scales with the size of the 
+   * change rather than the size of the design.
+   */
+  class EcoPlacer
+  {
+  public:
+    //! Constructor taking the chip holding the changed netlist.
+    EcoPlacer(sp::Chip *chip);
+
+    //! Place the chip from the placement file of the earlier netlist, see
+    //! Chip::writePlacement. Return whether the file could be read.
+    bool loadPlacement(const QString &f_path);
+
+    //! Return the blocks inserted by loadPlacement.
+    const QVector<int> &insertedBlocks() const {return inserted;}
+
+    //! \brief Anneal the region around the inserted blocks.
+    //!
+    //! Runs the Placer from the loaded placement with the multilevel
+    //! refinement temperature factor and the constructive range window of
+    //! the settings, drawing moves only for the inserted blocks and the 
+    //! blocks sharing nets of up to MAX_ECO_NET_SIZE pins with them; the 
+    //! blocks at their swap targets move along. Returns the placed cost 
+    //! without annealing if no block was inserted.
+    SAResults refine(const SASettings &sa_settings);
+
+  private:
+
+    //! Return the median location of the placed blocks sharing nets with
+    //! the block, the chip center if there are none.
+    QPair<int,int> neighbourMedian(int block_id);
+
+    //! Return the free cell nearest to the target in Chebyshev distance,
+    //! (-1,-1) if the chip is full.
+    QPair<int,int> nearestFreeCell(const QPair<int,int> &target);
+
+    // Private variables
+    sp::Chip *chip;           //!< The chip.
+    QVector<int> inserted;    //!< Blocks not placed at their old cells.
+    QVector<bool> placed;     //!< Whether each block has a cell yet.
+  };
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+// @file:     greedy.cc
+// @author:   Samuel Ng
+// @created:  2021-02-25
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the greedy gain bucket improver.
+
+#include <algorithm>
+#include "greedy.h"
+
+// nets larger than this do not mark their blocks for re-evaluation, the final
+// sweep catches any gains that were missed because of it
+#define MAX_TOUCH_NET_SIZE 32
+
+// gains above this share the top bucket
+#define MAX_BUCKET_GAIN 1024
+
+using namespace pc;
+
+GreedyImprover::GreedyImprover(sp::Chip *chip)
+  : chip(chip)
+{
+  versions.fill(0, chip->numBlocks());
+  touch_stamp.fill(0, chip->numBlocks());
+}
+
+qint64 GreedyImprover::improve(int t_win_dim)
+{
+  win_dim = std::max(std::min(t_win_dim, std::max(chip->dimX(), chip->dimY())), 2);
+  buckets = QVector<QVector<Entry>>(MAX_BUCKET_GAIN + 1);
+  max_gain = 0;
+
+  qint64 total_delta = 0;
+  bool swept_clean = false;
+  while (!swept_clean) {
+    // (re)evaluate all blocks
+    swept_clean = true;
+    for (int bid=0; bid<chip->numBlocks(); bid++) {
+      swept_clean &= !updateBlock(bid);
+    }
+
+    // apply the best swaps until the queue runs dry
+    while (max_gain > 0) {
+      if (buckets[max_gain].isEmpty()) {
+        max_gain--;
+        continue;
+      }
+      Entry entry = buckets[max_gain].takeLast();
+      if (entry.version != versions[entry.bid]) {
+        continue;
+      }
+      // the entry may be stale if its surroundings have changed
+      qint64 delta = swapDelta(entry.bid, entry.target);
+      if (delta >= 0) {
+        updateBlock(entry.bid);
+        continue;
+      }
+      int bid_b = chip->blockIdAt(entry.target % chip->dimX(), entry.target / chip->dimX());
+      applySwap(entry.bid, entry.target);
+      total_delta += delta;
+
+      // re-evaluate the moved blocks and their neighbors
+      stamp++;
+      touched.clear();
+      touchNeighbors(entry.bid);
+      if (bid_b != -1) {
+        touchNeighbors(bid_b);
+      }
+      for (int bid : touched) {
+        updateBlock(bid);
+      }
+    }
+  }
+  return total_delta;
+}
+
+bool GreedyImprover::updateBlock(int bid)
+{
+  versions[bid]++;
+  QPair<int,int> loc = chip->blockLoc(bid);
+
+  qint64 best_delta = 0;
+  int best_target = -1;
+  QRect win = chip->rangeWindow(loc, win_dim);
+  for (int y=win.top(); y<=win.bottom(); y++) {
+    for (int x=win.left(); x<=win.right(); x++) {
+      if (x == loc.first && y == loc.second) {
+        continue;
+      }
+      int target = y * chip->dimX() + x;
+      qint64 delta = swapDelta(bid, target);
+      if (delta < best_delta) {
+        best_delta = delta;
+        best_target = target;
+      }
+    }
+  }
+  if (best_target == -1) {
+    return false;
+  }
+
+  int gain = (int)std::min(-best_delta, (qint64)MAX_BUCKET_GAIN);
+  buckets[gain].append({bid, best_target, versions[bid]});
+  max_gain = std::max(max_gain, gain);
+  return true;
+}
+
+qint64 GreedyImprover::swapDelta(int bid, int target)
+{
+  n_evals++;
+  QPair<int,int> loc = chip->blockLoc(bid);
+  return chip->calcSwapCostDelta(loc.first, loc.second,
+      target % chip->dimX(), target / chip->dimX());
+}
+
+void GreedyImprover::applySwap(int bid, int target)
+{
+  QPair<int,int> loc_a = chip->blockLoc(bid);
+  QPair<int,int> loc_b(target % chip->dimX(), target / chip->dimX());
+  int bid_b = chip->blockIdAt(loc_b);
+  chip->setLocBlock(loc_a, bid_b);
+  chip->setLocBlock(loc_b, bid);
+}
+
+void GreedyImprover::touchNeighbors(int bid)
+{
+  sp::Graph *graph = chip->getGraph();
+  auto touch = [this](int t_bid) {
+    if (touch_stamp[t_bid] != stamp) {
+      touch_stamp[t_bid] = stamp;
+      touched.append(t_bid);
+    }
+  };
+  touch(bid);
+  for (int net_id : graph->blockNets(bid)) {
+    const QList<int> &net = graph->getNet(net_id);
+    if (net.size() > MAX_TOUCH_NET_SIZE) {
+      continue;
+    }
+    for (int n_bid : net) {
+      touch(n_bid);
+    }
+  }
+}
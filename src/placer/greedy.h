@@ -0,0 +1,75 @@
+/*!
+  \file greedy.h
+  \brief Greedy gain bucket improvement for the zero temperature phase.
+  \author Samuel Ng
+  \date 2021-02-25 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_GREEDY_H_
+#define _PC_GREEDY_H_
+
+#include "spatial.h"
+
+namespace pc {
+
+  /*! \brief Steepest descent swapping driven by a bucket priority queue.
+   *
+   * Every block keeps the best improving swap found within a square window 
+   * centered at its location, and is filed into the bucket of that swap's 
+   * gain. The highest gain entry is popped and re-evaluated (entries are 
+   * updated lazily), then applied if it still improves the cost. Only blocks
+   * that share nets with the moved blocks get their best swaps recomputed. 
+   * Once the queue runs dry, a final sweep over all blocks confirms that the
+   * placement is a local minimum with respect to the window.
+   */
+  class GreedyImprover
+  {
+  public:
+    //! Constructor taking the chip to be improved.
+    GreedyImprover(sp::Chip *chip);
+
+    //! Improve the placement with swaps inside a win_dim by win_dim window
+    //! around each block and return the (non-positive) cost change.
+    qint64 improve(int win_dim=5);
+
+    //! Return the number of swap cost deltas evaluated so far.
+    long evaluations() const {return n_evals;}
+
+  private:
+
+    //! Bucket queue entry, only valid if the version matches the block's.
+    struct Entry {
+      int bid;      //!< Block to be moved.
+      int target;   //!< Grid index of the swap target.
+      int version;  //!< Version of the block at the time of insertion.
+    };
+
+    //! Find the best improving swap of the block and file it into a bucket.
+    //! Return whether an improving swap was found.
+    bool updateBlock(int bid);
+
+    //! Evaluate the swap of the block with the target grid index.
+    qint64 swapDelta(int bid, int target);
+
+    //! Apply the swap of the block with the target grid index.
+    void applySwap(int bid, int target);
+
+    //! Mark blocks sharing nets with the specified block for re-evaluation.
+    void touchNeighbors(int bid);
+
+    // Private variables
+    sp::Chip *chip;               //!< The chip to be improved.
+    int win_dim=5;                //!< Window dimension.
+    long n_evals=0;               //!< Number of cost deltas evaluated.
+    QVector<QVector<Entry>> buckets;  //!< Entries indexed by gain.
+    int max_gain=0;               //!< Highest possibly non-empty bucket.
+    QVector<int> versions;        //!< Current version of each block.
+    QVector<int> touched;         //!< Blocks pending re-evaluation.
+    QVector<int> touch_stamp;     //!< Per-block marker to deduplicate touched.
+    int stamp=0;                  //!< Current marker value.
+  };
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+// @file:     legalizer.cc
+// @author:   Samuel Ng
+// @created:  2021-02-21
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the legalizer.
+
+#include <algorithm>
+#include <numeric>
+#include <math.h>
+#include "legalizer.h"
+
+using namespace pc;
+
+void Legalizer::legalize(sp::Chip *chip, const QVector<QPointF> &targets)
+{
+  int nx = chip->dimX();
+  int ny = chip->dimY();
+  int n_blocks = chip->numBlocks();
+  auto clampRound = [](qreal val, int max_val) {
+    return std::max(0, std::min((int)std::lround(val), max_val));
+  };
+
+  // sort blocks by target y, breaking ties by target x
+  QVector<int> order(n_blocks);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&targets](int a, int b) {
+        return targets[a].y() < targets[b].y()
+          || (targets[a].y() == targets[b].y() && targets[a].x() < targets[b].x());
+      });
+
+  // distribute into rows, only advance to the desired row if the rows after
+  // the current one can still hold all remaining blocks
+  QVector<QVector<int>> rows(ny);
+  int row = 0;
+  for (int i=0; i<n_blocks; i++) {
+    int bid = order[i];
+    int remaining = n_blocks - i;
+    int desired = clampRound(targets[bid].y(), ny-1);
+    while (row < desired && (ny - row - 1) * nx >= remaining) {
+      row++;
+    }
+    if (rows[row].size() == nx) {
+      row++;
+    }
+    rows[row].append(bid);
+  }
+
+  // distribute each row into columns in the same manner
+  chip->initEmptyPlacements();
+  for (int y=0; y<ny; y++) {
+    QVector<int> &row_bids = rows[y];
+    std::stable_sort(row_bids.begin(), row_bids.end(), [&targets](int a, int b) {
+          return targets[a].x() < targets[b].x();
+        });
+    int col = 0;
+    for (int j=0; j<row_bids.size(); j++) {
+      int remaining = row_bids.size() - j;
+      int desired = clampRound(targets[row_bids[j]].x(), nx-1);
+      col = std::max(col, std::min(desired, nx - remaining));
+      chip->setLocBlock(qMakePair(col, y), row_bids[j]);
+      col++;
+    }
+  }
+}
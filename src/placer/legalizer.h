@@ -0,0 +1,36 @@
+/*!
+  \file legalizer.h
+  \brief Legalization of continuous block positions onto the chip grid.
+  \author Samuel Ng
+  \date 2021-02-21 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_LEGALIZER_H_
+#define _PC_LEGALIZER_H_
+
+#include <QtWidgets>
+#include "spatial.h"
+
+namespace pc {
+
+  //! Legalize target block positions onto distinct grid cells.
+  class Legalizer
+  {
+  public:
+
+    /*! \brief Place all blocks of the chip onto distinct cells near targets.
+     *
+     * Clear the chip and place each block as close as possible to its target
+     * position (in grid cell units, may be fractional or out of bounds). 
+     * Blocks are first distributed into rows by their target y and then into
+     * columns by their target x, both in an order-preserving manner that never
+     * exceeds the remaining capacity. Runs in O(n log n). Does not update the 
+     * stored cost of the chip.
+     */
+    static void legalize(sp::Chip *chip, const QVector<QPointF> &targets);
+  };
+
+}
+
+#endif
@@ -0,0 +1,301 @@
+// @file:     mincut.cc
+// @author:   Samuel Ng
+// @created:  2021-02-23
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the recursive min-cut placer.
+
+#include <algorithm>
+#include "mincut.h"
+
+// FM passes are repeated until no improvement or this many passes
+#define MAX_FM_PASSES 8
+
+using namespace pc;
+
+MinCutPlacer::MinCutPlacer(sp::Chip *chip, unsigned int seed)
+  : chip(chip), mt(seed)
+{}
+
+qint64 MinCutPlacer::place()
+{
+  int n_blocks = chip->numBlocks();
+  QRect chip_rect(0, 0, chip->dimX(), chip->dimY());
+  QPointF chip_center((chip->dimX() - 1) / 2., (chip->dimY() - 1) / 2.);
+  block_pos.fill(chip_center, n_blocks);
+  local_id.fill(-1, n_blocks);
+  chip->initEmptyPlacements();
+
+  // breadth first so that terminals are propagated from refined positions
+  QQueue<Region> queue;
+  Region root;
+  root.rect = chip_rect;
+  root.blocks.resize(n_blocks);
+  for (int bid=0; bid<n_blocks; bid++) {
+    root.blocks[bid] = bid;
+  }
+  queue.enqueue(root);
+  while (!queue.isEmpty()) {
+    Region region = queue.dequeue();
+    if (region.blocks.isEmpty()) {
+      continue;
+    }
+    if (region.rect.width() * region.rect.height() == 1) {
+      // the region is down to a single cell which can hold a single block
+      chip->setLocBlock(qMakePair(region.rect.left(), region.rect.top()),
+          region.blocks.first());
+      continue;
+    }
+    bisect(region, queue);
+  }
+  return chip->calcCost();
+}
+
+void MinCutPlacer::bisect(const Region &region, QQueue<Region> &queue)
+{
+  // cut across the longer side, vertical distances cost twice as much
+  const QRect &rect = region.rect;
+  bool cut_vertical = rect.width() >= 2 * rect.height() || rect.height() == 1;
+  Region half_0, half_1;
+  half_0.rect = half_1.rect = rect;
+  qreal cut_pos;
+  if (cut_vertical) {
+    half_0.rect.setWidth(rect.width() / 2);
+    half_1.rect.setLeft(half_0.rect.right() + 1);
+    cut_pos = half_1.rect.left() - 0.5;
+  } else {
+    half_0.rect.setHeight(rect.height() / 2);
+    half_1.rect.setTop(half_0.rect.bottom() + 1);
+    cut_pos = half_1.rect.top() - 0.5;
+  }
+
+  // side 0 takes blocks in proportion to its area within the capacities
+  int n = region.blocks.size();
+  int cap_0 = half_0.rect.width() * half_0.rect.height();
+  int cap_1 = half_1.rect.width() * half_1.rect.height();
+  int target_0 = qRound((qreal)n * cap_0 / (cap_0 + cap_1));
+  int tol = std::max(1, n / 50);
+  int min_0 = std::max(std::max(target_0 - tol, n - cap_1), 0);
+  int max_0 = std::min(std::min(target_0 + tol, cap_0), n);
+  target_0 = std::max(std::min(target_0, max_0), min_0);
+
+  // random initial partition of the exact target size
+  QVector<int> shuffled = region.blocks;
+  std::shuffle(shuffled.begin(), shuffled.end(), mt);
+  QVector<int> side_of(n);
+  for (int i=0; i<n; i++) {
+    local_id[shuffled[i]] = i;
+    side_of[i] = (i < target_0) ? 0 : 1;
+  }
+  if (n > 1) {
+    partitionFM(shuffled, side_of, min_0, max_0, cut_vertical, cut_pos);
+  }
+
+  // assign blocks to halves and update their positions
+  QPointF center_0(half_0.rect.left() + (half_0.rect.width() - 1) / 2.,
+      half_0.rect.top() + (half_0.rect.height() - 1) / 2.);
+  QPointF center_1(half_1.rect.left() + (half_1.rect.width() - 1) / 2.,
+      half_1.rect.top() + (half_1.rect.height() - 1) / 2.);
+  for (int i=0; i<n; i++) {
+    int bid = shuffled[i];
+    local_id[bid] = -1;
+    if (side_of[i] == 0) {
+      half_0.blocks.append(bid);
+      block_pos[bid] = center_0;
+    } else {
+      half_1.blocks.append(bid);
+      block_pos[bid] = center_1;
+    }
+  }
+  queue.enqueue(half_0);
+  queue.enqueue(half_1);
+}
+
+void MinCutPlacer::partitionFM(const QVector<int> &blocks, QVector<int> &side_of,
+    int min_0, int max_0, bool cut_vertical, qreal cut_pos)
+{
+  sp::Graph *graph = chip->getGraph();
+  int n = blocks.size();
+
+  // collect the nets of the region with their free pins and fixed terminals
+  QVector<QVector<int>> net_cells;   // local cell IDs of each local net
+  QVector<QVector<int>> cell_nets(n);// local net IDs of each cell
+  QVector<int> fixed[2];             // fixed terminals on each side of each net
+  QHash<int,int> local_net;
+  for (int i=0; i<n; i++) {
+    for (int net_id : graph->blockNets(blocks[i])) {
+      int lnid = local_net.value(net_id, -1);
+      if (lnid == -1) {
+        // first encounter, build the local net
+        QVector<int> cells;
+        int n_fixed[2] = {0, 0};
+        for (int bid : graph->getNet(net_id)) {
+          if (local_id[bid] != -1) {
+            cells.append(local_id[bid]);
+          } else {
+            qreal pos = cut_vertical ? block_pos[bid].x() : block_pos[bid].y();
+            n_fixed[pos < cut_pos ? 0 : 1]++;
+          }
+        }
+        if (cells.size() + (n_fixed[0] > 0) + (n_fixed[1] > 0) < 2) {
+          // a single pin in the region and nothing outside can never be cut
+          local_net.insert(net_id, -2);
+          continue;
+        }
+        lnid = net_cells.size();
+        local_net.insert(net_id, lnid);
+        net_cells.append(cells);
+        fixed[0].append(n_fixed[0]);
+        fixed[1].append(n_fixed[1]);
+        for (int cell : cells) {
+          cell_nets[cell].append(lnid);
+        }
+      }
+    }
+  }
+  int p_max = 1;
+  for (const QVector<int> &nets : cell_nets) {
+    p_max = std::max(p_max, nets.size());
+  }
+
+  // gain bucket structure, one per side, doubly linked through cell IDs
+  QVector<int> count[2];
+  QVector<int> gain(n), next(n), prev(n);
+  QVector<bool> locked(n);
+  QVector<int> bucket_head[2];
+  int max_gain[2];
+  auto bucketRemove = [&](int cell) {
+    int side = side_of[cell];
+    if (prev[cell] != -1) {
+      next[prev[cell]] = next[cell];
+    } else {
+      bucket_head[side][gain[cell] + p_max] = next[cell];
+    }
+    if (next[cell] != -1) {
+      prev[next[cell]] = prev[cell];
+    }
+  };
+  auto bucketInsert = [&](int cell) {
+    int side = side_of[cell];
+    int b = gain[cell] + p_max;
+    prev[cell] = -1;
+    next[cell] = bucket_head[side][b];
+    if (next[cell] != -1) {
+      prev[next[cell]] = cell;
+    }
+    bucket_head[side][b] = cell;
+    max_gain[side] = std::max(max_gain[side], gain[cell]);
+  };
+  auto adjustGain = [&](int cell, int delta) {
+    if (locked[cell]) {
+      return;
+    }
+    bucketRemove(cell);
+    gain[cell] += delta;
+    bucketInsert(cell);
+  };
+
+  for (int pass=0; pass<MAX_FM_PASSES; pass++) {
+    // initialize net side counts including fixed terminals
+    for (int s=0; s<2; s++) {
+      count[s] = fixed[s];
+    }
+    int size_0 = 0;
+    for (int cell=0; cell<n; cell++) {
+      size_0 += (side_of[cell] == 0);
+      for (int lnid : cell_nets[cell]) {
+        count[side_of[cell]][lnid]++;
+      }
+    }
+
+    // initialize gains and buckets
+    for (int s=0; s<2; s++) {
+      bucket_head[s].fill(-1, 2*p_max+1);
+      max_gain[s] = -p_max;
+    }
+    for (int cell=0; cell<n; cell++) {
+      int from = side_of[cell];
+      gain[cell] = 0;
+      for (int lnid : cell_nets[cell]) {
+        gain[cell] += (count[from][lnid] == 1) - (count[1-from][lnid] == 0);
+      }
+      locked[cell] = false;
+      bucketInsert(cell);
+    }
+
+    // move cells one at a time, recording the best prefix of moves
+    QVector<int> moved;
+    int cum_gain = 0, best_gain = 0, best_n_moved = 0;
+    for (int step=0; step<n; step++) {
+      // candidate from each side that respects the balance after the move
+      int best_cell = -1;
+      for (int from=0; from<2; from++) {
+        int new_size_0 = size_0 + (from == 0 ? -1 : 1);
+        if (new_size_0 < min_0 || new_size_0 > max_0) {
+          continue;
+        }
+        while (max_gain[from] > -p_max && bucket_head[from][max_gain[from] + p_max] == -1) {
+          max_gain[from]--;
+        }
+        int cell = bucket_head[from][max_gain[from] + p_max];
+        if (cell != -1 && (best_cell == -1 || gain[cell] > gain[best_cell])) {
+          best_cell = cell;
+        }
+      }
+      if (best_cell == -1) {
+        break;
+      }
+
+      // move the cell and update neighbor gains with the standard FM rules
+      int from = side_of[best_cell];
+      int to = 1 - from;
+      cum_gain += gain[best_cell];
+      bucketRemove(best_cell);
+      locked[best_cell] = true;
+      for (int lnid : cell_nets[best_cell]) {
+        const QVector<int> &cells = net_cells[lnid];
+        // before the move
+        if (count[to][lnid] == 0) {
+          for (int c : cells) {
+            adjustGain(c, 1);
+          }
+        } else if (count[to][lnid] == 1) {
+          for (int c : cells) {
+            if (side_of[c] == to) {
+              adjustGain(c, -1);
+            }
+          }
+        }
+        count[from][lnid]--;
+        count[to][lnid]++;
+        // after the move
+        if (count[from][lnid] == 0) {
+          for (int c : cells) {
+            adjustGain(c, -1);
+          }
+        } else if (count[from][lnid] == 1) {
+          for (int c : cells) {
+            if (side_of[c] == from && c != best_cell) {
+              adjustGain(c, 1);
+            }
+          }
+        }
+      }
+      side_of[best_cell] = to;
+      size_0 += (from == 0) ? -1 : 1;
+      moved.append(best_cell);
+      if (cum_gain > best_gain) {
+        best_gain = cum_gain;
+        best_n_moved = moved.size();
+      }
+    }
+
+    // roll back the moves after the best prefix
+    for (int i=moved.size()-1; i>=best_n_moved; i--) {
+      side_of[moved[i]] = 1 - side_of[moved[i]];
+    }
+    if (best_gain <= 0) {
+      break;
+    }
+  }
+}
@@ -0,0 +1,68 @@
+/*!
+  \file mincut.h
+  \brief Recursive min-cut bisection placement.
+  \author Samuel Ng
+  \date 2021-02-23 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_MINCUT_H_
+#define _PC_MINCUT_H_
+
+#include <QQueue>
+#include <random>
+#include "spatial.h"
+
+namespace pc {
+
+  /*! \brief Recursive bisection placement with Fiduccia-Mattheyses partitioning.
+   *
+   * Regions of the chip are processed breadth first starting from the whole
+   * chip. Each region is cut in half across its longer side (vertical 
+   * distances count twice) and its blocks are partitioned between the two
+   * halves in proportion to their areas by FM with gain buckets. Pins outside
+   * of the region are propagated as fixed terminals on the side of the cut 
+   * closest to the center of their current region. Regions are split until
+   * they are a single cell.
+   */
+  class MinCutPlacer
+  {
+  public:
+    //! Constructor taking the chip to be placed and the RNG seed for the 
+    //! initial partitions.
+    MinCutPlacer(sp::Chip *chip, unsigned int seed);
+
+    //! Place all blocks onto the chip and return the resulting cost.
+    qint64 place();
+
+  private:
+
+    //! A rectangular region of the chip and the blocks assigned to it.
+    struct Region
+    {
+      QRect rect;           //!< Cells covered by the region.
+      QVector<int> blocks;  //!< Blocks assigned to the region.
+    };
+
+    //! Split the region into two and append the halves to the queue.
+    void bisect(const Region &region, QQueue<Region> &queue);
+
+    //! \brief Partition blocks into sides 0 and 1 by FM.
+    //!
+    //! side_of holds the initial partition and receives the result. Side 0 
+    //! must end up with between min_0 and max_0 blocks. cut_vertical 
+    //! indicates that the cut line is vertical at x=cut_pos, otherwise it is
+    //! horizontal at y=cut_pos (used for terminal propagation).
+    void partitionFM(const QVector<int> &blocks, QVector<int> &side_of,
+        int min_0, int max_0, bool cut_vertical, qreal cut_pos);
+
+    // Private variables
+    sp::Chip *chip;             //!< The chip to be placed.
+    std::mt19937 mt;            //!< Use the Mersenne Twister PRNG.
+    QVector<QPointF> block_pos; //!< Center of the region each block is in.
+    QVector<int> local_id;      //!< Index of each block in the current region, -1 if outside.
+  };
+
+}
+
+#endif
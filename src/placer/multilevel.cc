@@ -0,0 +1,205 @@
+// @file:     multilevel.cc
+// @author:   Samuel Ng
+// @created:  2021-02-21
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the multilevel placement flow.
+
+#include <algorithm>
+#include <numeric>
+#include <math.h>
+#include "multilevel.h"
+#include "legalizer.h"
+
+// nets with more blocks than this are ignored when matching, they say little
+// about which pairs of blocks belong together
+#define MAX_MATCHING_NET_SIZE 16
+
+using namespace pc;
+
+MultilevelPlacer::MultilevelPlacer(sp::Chip *chip)
+  : chip(chip), mt(rd())
+{}
+
+MultilevelPlacer::~MultilevelPlacer()
+{
+  for (sp::Chip *level : levels) {
+    delete level;
+  }
+}
+
+bool MultilevelPlacer::buildHierarchy(int coarsest_blocks)
+{
+  sp::Chip *fine = chip;
+  while (fine->numBlocks() > coarsest_blocks) {
+    QVector<int> cluster_of;
+    sp::Chip *coarse = coarsen(fine, cluster_of);
+    // stop if matching no longer shrinks the netlist appreciably
+    if (coarse->numBlocks() > 0.9 * fine->numBlocks()) {
+      delete coarse;
+      break;
+    }
+    levels.append(coarse);
+    cluster_ofs.append(cluster_of);
+    fine = coarse;
+  }
+  return !levels.isEmpty();
+}
+
+SAResults MultilevelPlacer::placeCoarseLevels(const SASettings &sa_settings)
+{
+  SAResults results;
+  results.iterations = 0;
+  results.moves = 0;
+  if (levels.isEmpty()) {
+    return results;
+  }
+
+  // anneal the coarsest level with the full settings
+  SASettings coarsest_settings = sa_settings;
+  coarsest_settings.multilevel = false;
+  coarsest_settings.gui_up = GuiFinalOnly;
+  Placer coarsest_placer(levels.last());
+  SAResults level_results = coarsest_placer.runPlacer(coarsest_settings);
+  results.iterations += std::max(level_results.iterations, 0);
+  results.moves += std::max(level_results.moves, 0L);
+  results.evaluations += level_results.evaluations;
+  if (sa_settings.show_stdout) {
+    qDebug() << QObject::tr("Coarsest level with %1 blocks placed at cost %2")
+      .arg(levels.last()->numBlocks()).arg(level_results.cost);
+  }
+
+  // project and refine intermediate levels
+  SASettings refine_settings = refineSettings(sa_settings);
+  refine_settings.gui_up = GuiFinalOnly;
+  for (int lvl=levels.size()-2; lvl>=0; lvl--) {
+    project(levels[lvl+1], levels[lvl], cluster_ofs[lvl+1]);
+    Placer level_placer(levels[lvl]);
+    level_results = level_placer.runPlacer(refine_settings);
+    results.iterations += std::max(level_results.iterations, 0);
+    results.moves += std::max(level_results.moves, 0L);
+    results.evaluations += level_results.evaluations;
+    if (sa_settings.show_stdout) {
+      qDebug() << QObject::tr("Level with %1 blocks refined to cost %2")
+        .arg(levels[lvl]->numBlocks()).arg(level_results.cost);
+    }
+  }
+
+  // project onto the input chip, refinement is up to the caller
+  project(levels.first(), chip, cluster_ofs.first());
+  return results;
+}
+
+SASettings MultilevelPlacer::refineSettings(const SASettings &sa_settings)
+{
+  SASettings refine_settings = sa_settings;
+  refine_settings.multilevel = false;
+  refine_settings.init_place = InitPlace::ExistingInit;
+  refine_settings.init_t_fact = sa_settings.ml_refine_t_fact;
+  refine_settings.init_rw_dim = sa_settings.ml_refine_rw_dim;
+  refine_settings.swap_fact = sa_settings.ml_refine_swap_fact;
+  refine_settings.max_its = sa_settings.ml_refine_its;
+  return refine_settings;
+}
+
+sp::Chip *MultilevelPlacer::coarsen(sp::Chip *fine, QVector<int> &cluster_of)
+{
+  sp::Graph *graph = fine->getGraph();
+  int n_blocks = fine->numBlocks();
+
+  // heavy edge matching in random order, with clique edge weights 1/(k-1)
+  QVector<int> order(n_blocks);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), mt);
+  cluster_of.fill(-1, n_blocks);
+  QVector<float> conn(n_blocks, 0);
+  QVector<int> touched;
+  int n_clusters = 0;
+  for (int bid : order) {
+    if (cluster_of[bid] != -1) {
+      continue;
+    }
+    // accumulate connection weights to unmatched neighbors
+    touched.clear();
+    for (int net_id : graph->blockNets(bid)) {
+      const QList<int> &net = graph->getNet(net_id);
+      if (net.size() < 2 || net.size() > MAX_MATCHING_NET_SIZE) {
+        continue;
+      }
+      float weight = 1. / (net.size() - 1);
+      for (int nbid : net) {
+        if (nbid != bid && cluster_of[nbid] == -1) {
+          if (conn[nbid] == 0) {
+            touched.append(nbid);
+          }
+          conn[nbid] += weight;
+        }
+      }
+    }
+    // match with the most strongly connected neighbor if any
+    int best_bid = -1;
+    float best_conn = 0;
+    for (int nbid : touched) {
+      if (conn[nbid] > best_conn) {
+        best_conn = conn[nbid];
+        best_bid = nbid;
+      }
+      conn[nbid] = 0;
+    }
+    cluster_of[bid] = n_clusters;
+    if (best_bid != -1) {
+      cluster_of[best_bid] = n_clusters;
+    }
+    n_clusters++;
+  }
+
+  // map nets onto clusters, nets entirely within a cluster are dropped
+  QVector<QList<int>> coarse_nets;
+  QVector<int> coarse_weights;
+  for (int net_id=0; net_id<fine->numNets(); net_id++) {
+    const QList<int> &net = graph->getNet(net_id);
+    QList<int> coarse_net;
+    for (int bid : net) {
+      coarse_net.append(cluster_of[bid]);
+    }
+    std::sort(coarse_net.begin(), coarse_net.end());
+    coarse_net.erase(std::unique(coarse_net.begin(), coarse_net.end()), coarse_net.end());
+    if (coarse_net.size() > 1) {
+      coarse_nets.append(coarse_net);
+      coarse_weights.append(graph->netWeight(net_id));
+    }
+  }
+
+  // shrink the chip proportionally while keeping its aspect ratio
+  float scale = sqrt((float)n_clusters / n_blocks);
+  int nx = std::max((int)std::ceil(fine->dimX() * scale), 1);
+  int ny = std::max((int)std::ceil(fine->dimY() * scale), 1);
+  while (nx * ny < n_clusters) {
+    (nx * fine->dimY() < ny * fine->dimX()) ? nx++ : ny++;
+  }
+  sp::Chip *coarse = new sp::Chip(nx, ny, n_clusters, coarse_nets, 
+      fine->gridLayout());
+  for (int net_id=0; net_id<coarse_weights.size(); net_id++) {
+    coarse->getGraph()->setNetWeight(net_id, coarse_weights[net_id]);
+  }
+  coarse->setCostModel(fine->costModel());
+  coarse->setHighFanoutThreshold(fine->highFanoutThreshold());
+  coarse->setSimdLevel(fine->simdLevel());
+  coarse->setCostThreads(fine->costThreads());
+  return coarse;
+}
+
+void MultilevelPlacer::project(sp::Chip *coarse, sp::Chip *fine,
+    const QVector<int> &cluster_of)
+{
+  // blocks target the center of their cluster's cell scaled to the fine chip,
+  // the legalizer then spreads out blocks sharing a target
+  qreal sx = (qreal)fine->dimX() / coarse->dimX();
+  qreal sy = (qreal)fine->dimY() / coarse->dimY();
+  QVector<QPointF> targets(fine->numBlocks());
+  for (int bid=0; bid<fine->numBlocks(); bid++) {
+    QPair<int,int> loc = coarse->blockLoc(cluster_of[bid]);
+    targets[bid] = QPointF((loc.first + 0.5) * sx - 0.5, (loc.second + 0.5) * sy - 0.5);
+  }
+  Legalizer::legalize(fine, targets);
+}
@@ -0,0 +1,72 @@
+/*!
+  \file multilevel.h
+  \brief Multilevel (coarsen, anneal, refine) placement flow.
+  \author Samuel Ng
+  \date 2021-02-21 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_MULTILEVEL_H_
+#define _PC_MULTILEVEL_H_
+
+#include <random>
+#include "spatial.h"
+#include "placer.h"
+
+namespace pc {
+
+  /*! \brief Multilevel placement over a hierarchy of clustered netlists.
+   *
+   * Strongly connected blocks are repeatedly clustered by heavy edge matching
+   * over the Graph until the netlist is small enough. Each coarse netlist is
+   * placed on a proportionally smaller Chip. The coarsest level is annealed
+   * with the full settings, after which each level is projected onto the next
+   * finer one, legalized and refined with a short low temperature anneal.
+   * The refinement of the input chip itself is left to the caller.
+   */
+  class MultilevelPlacer
+  {
+  public:
+    //! Constructor taking the chip to be placed.
+    MultilevelPlacer(sp::Chip *chip);
+
+    //! Destructor, deletes all coarse chips.
+    ~MultilevelPlacer();
+
+    //! Build the cluster hierarchy until at most coarsest_blocks remain.
+    //! Return false if the chip could not be coarsened at all.
+    bool buildHierarchy(int coarsest_blocks);
+
+    //! Anneal the coarsest level, then project and refine down the hierarchy 
+    //! and leave the projected placement on the input chip. Returns the 
+    //! accumulated iterations and moves of all coarse level anneals.
+    SAResults placeCoarseLevels(const SASettings &sa_settings);
+
+    //! Return the coarse chips, from finest to coarsest.
+    const QList<sp::Chip*> &coarseLevels() const {return levels;}
+
+    //! Return the settings used for the refinement anneals.
+    static SASettings refineSettings(const SASettings &sa_settings);
+
+  private:
+
+    //! Cluster the blocks of the provided chip, write the cluster of each 
+    //! block to cluster_of and return the coarse chip. The coarse chip takes
+    //! the net weights, cost model, grid layout and evaluation settings of 
+    //! the fine chip so that all levels optimize the same objective.
+    sp::Chip *coarsen(sp::Chip *fine, QVector<int> &cluster_of);
+
+    //! Project the placement of the coarse chip onto the fine chip.
+    void project(sp::Chip *coarse, sp::Chip *fine, const QVector<int> &cluster_of);
+
+    // Private variables
+    sp::Chip *chip;                 //!< The input chip.
+    QList<sp::Chip*> levels;        //!< Coarse chips, from finest to coarsest.
+    QList<QVector<int>> cluster_ofs;//!< Map from blocks of the next finer level to blocks of each coarse chip.
+    std::random_device rd;          //!< Random device.
+    std::mt19937 mt;                //!< Use the Mersenne Twister PRNG.
+  };
+
+}
+
+#endif
@@ -6,12 +6,49 @@
 // @desc:     Implementation of the placer.
 
 #include <algorithm>
+#include <limits>
+#include <numeric>
+#include <sstream>
 #include <math.h>
 #include "placer.h"
+#include "multilevel.h"
+#include "quadratic.h"
+#include "mincut.h"
+#include "detailed.h"
+#include "greedy.h"
+#include "rejectionfree.h"
 
 #define coord_ind(x,y,nx) x+y*nx;
 #define ind_coord(ind,nx) qMakePair(ind%nx, (ind-ind%nx)/nx);
 
+// gain of the Lam temperature controller, T is scaled by 
+// exp(-LAM_T_GAIN * (accept_rate - target_rate)) every step
+#define LAM_T_GAIN 3
+
+// final T of schedules compressed to fit into a time budget, relative to the
+// initial T
+#define BUDGET_FINAL_T_FACT 1e-3
+
+// steps are made in chunks of this many moves between which cancellation 
+// and the time budget are checked. With a time budget, steps are cut short 
+// so that at least BUDGET_MIN_STEPS of them fit into the budget
+#define STEP_CHUNK_MOVES 4096
+#define BUDGET_MIN_STEPS 50
+
+// nets larger than this are ignored when looking for directed move targets
+#define MAX_DIRECTED_NET_SIZE 32
+
+// compound move limits: longest shifted segment, largest moved cluster and 
+// largest net considered for cluster membership
+#define MAX_SHIFT_LEN 8
+#define MAX_CLUSTER_SIZE 3
+#define MAX_CLUSTER_NET_SIZE 8
+
+// move targets on sparse grids are drawn within this many cells of a random 
+// block, retried this many times before falling back to a uniform draw
+#define SPARSE_SITE_RADIUS 1
+#define SPARSE_SITE_TRIES 4
+
 using namespace pc;
 
 Placer::Placer(sp::Chip *t_chip)
@@ -24,157 +61,610 @@ Placer::Placer(sp::Chip *t_chip)
   prob_dist = std::uniform_real_distribution<float>(0.0, 1.0);
 }
 
+Placer::~Placer()
+{
+  delete rf_sampler;
+}
+
 SAResults Placer::runPlacer(const SASettings &t_sa_settings)
 {
+  if (!init(t_sa_settings)) {
+    return SAResults();
+  }
+  // every call makes the remaining moves of one temperature step
+  while (!isDone()) {
+    step(std::numeric_limits<long>::max());
+  }
+  return results();
+}
+
+bool Placer::init(const SASettings &t_sa_settings)
+{
+  // drop what is left of an unfinished run
+  if (!done) {
+    if (approx) {
+      chip->setApproxNetSize(-1);
+    }
+    if (keep_best) {
+      chip->stopJournal();
+    }
+    delete rf_sampler;
+    rf_sampler = nullptr;
+    done = true;
+  }
+  cancel_requested = false;
+  cancelled = false;
+  run_results = SAResults();
+
   // refuse to run if not initialized
   if (!chip->isInitialized()) {
     qWarning() << "Chip is uninitialized. Aborting placement.";
-    return SAResults();
+    return false;
+  }
+
+  run_timer.start();
+
+  // multilevel flow, coarse levels are placed onto the chip and then refined
+  // at the finest level by this placer
+  sa_settings = t_sa_settings;
+  ml_iterations = 0;
+  ml_moves = 0;
+  ml_evaluations = 0;
+  if (t_sa_settings.multilevel) {
+    MultilevelPlacer ml_placer(chip);
+    if (ml_placer.buildHierarchy(t_sa_settings.ml_coarsest_blocks)) {
+      SAResults ml_results = ml_placer.placeCoarseLevels(t_sa_settings);
+      ml_iterations = ml_results.iterations;
+      ml_moves = ml_results.moves;
+      ml_evaluations = ml_results.evaluations;
+      sa_settings = MultilevelPlacer::refineSettings(t_sa_settings);
+      if (t_sa_settings.time_budget_ms > 0) {
+        // the finest level gets what the coarse levels left of the budget
+        sa_settings.time_budget_ms = std::max(t_sa_settings.time_budget_ms 
+            - (int)run_timer.elapsed(), 1);
+        run_timer.restart();
+      }
+    }
   }
 
   // initialize the block positions and get the initial cost
-  chip->initEmptyPlacements();  // clear all previous costs and placements
-  initBlockPos();
+  float init_t_fact = sa_settings.init_t_fact;
+  int init_rw_dim = sa_settings.init_rw_dim;
+  switch (sa_settings.init_place) {
+    case InitPlace::RandomInit:
+      chip->initEmptyPlacements();  // clear all previous costs and placements
+      initBlockPos();
+      break;
+    case InitPlace::ExistingInit:
+      break;
+    case InitPlace::QuadraticInit:
+    {
+      // random placement provides the initial anchors of the quadratic placer
+      chip->initEmptyPlacements();
+      initBlockPos();
+      QuadraticPlacer qp(chip);
+      qint64 qp_cost = qp.place(sa_settings.qp_rounds);
+      init_t_fact = sa_settings.constructive_t_fact;
+      init_rw_dim = sa_settings.constructive_rw_dim;
+      if (sa_settings.show_stdout) {
+        qDebug() << tr("Quadratic initial placement cost=%1").arg(qp_cost);
+      }
+      break;
+    }
+    case InitPlace::MinCutInit:
+    {
+      MinCutPlacer mcp(chip, mt());
+      qint64 mc_cost = mcp.place();
+      init_t_fact = sa_settings.constructive_t_fact;
+      init_rw_dim = sa_settings.constructive_rw_dim;
+      if (sa_settings.show_stdout) {
+        qDebug() << tr("Min-cut initial placement cost=%1").arg(mc_cost);
+      }
+      break;
+    }
+  }
+
+  // fast mode, the run is done with the initial placement as is
+  if (sa_settings.skip_anneal) {
+    run_results.cost = run_results.init_cost = chip->calcCost();
+    run_results.iterations = 0;
+    run_results.moves = 0;
+    chip->setCost(run_results.cost);
+    if (sa_settings.gui_up <= GuiFinalOnly) {
+      emit sig_updateGui(chip);
+      emit sig_updateChart(run_results.cost, 0, -1, -1);
+    }
+    return true;
+  }
   if (chip->numBlocks() == 1) {
-    // on the off-chance that there is only one block to be placed, just return
-    return SAResults();
+    // on the off-chance that there is only one block to be placed, there is
+    // nothing to do
+    return true;
   }
 
   // set RNG distribution
   ind_dist = std::uniform_int_distribution<int>(0, chip->dimX()*chip->dimY()-1);
-  bid_dist = std::uniform_int_distribution<int>(0, chip->numBlocks()-1);
+  int n_sources = source_blocks.isEmpty() ? chip->numBlocks() : source_blocks.size();
+  bid_dist = std::uniform_int_distribution<int>(0, n_sources-1);
+  site_dist = std::uniform_int_distribution<int>(0, chip->numBlocks()-1);
+  sparse_sites = (chip->gridLayout() == sp::GridLayout::SparseHash);
+  sweep_order.clear();
+  resetSweep();
 
   // flags and variables
-  sa_settings = t_sa_settings;
   sa_settings.min_rw_dim = std::min(sa_settings.min_rw_dim, 
       std::min(chip->dimX(), chip->dimY()));
-  bool exit_cond = false;           // exit conditions met
-  bool main_done = false;           // main finish conditions satisfied
-  int abs_zero_cycles = 3;          // number of cycles to run at T=0
-  int cycle_attempts = sa_settings.swap_fact * pow(chip->numBlocks(), (4./3));
-  cycle_attempts = std::max(cycle_attempts, 1); // at least 1 attempt per cycle
-  int iterations = 0;               // current SA iteration
-  int iterations_cost_unchanged = 0;// cost has been unchanged for this many iters
-  QPair<int,int> coord_a, coord_b;  // coordinates to be swapped
-  int bid_a, bid_b;                 // block IDs a and b for the swap
+  done = false;
+  in_step = false;
+  main_done = false;
+  abs_zero_cycles = 3;
+  cycle_attempts = sa_settings.swap_fact * pow(n_sources, (4./3));
+  cycle_attempts = std::max(cycle_attempts, 1L); // at least 1 attempt per cycle
+  iterations = 0;
+  moves = 0;
+  evaluations = 0;
+  iterations_cost_unchanged = 0;
+  lam_target = 1;
+  last_p_accept = -1;
+  runtime_opts = runtimeMoveOpts();
+  move_loop = sa_settings.specialized_loop ? selectMoveLoop(runtime_opts)
+    : &Placer::genericMoveLoop;
+  batched = sa_settings.batch_size > 1 && !runtime_opts.compound 
+    && !runtime_opts.gui_each_swap;
   emit sig_updateGui(chip);         // instruct GUI to show initial random placement
 
-  // start the loop with an initial temperature
-  float T = initTempSV(50, 20);     // this must come before the first calcCost
-  int cost = chip->calcCost();      // calculate initial cost of rand. placement
+  // initialize range window
+  rw_dim = std::max(chip->dimX(), chip->dimY());
+  if (init_rw_dim > 0) {
+    rw_dim = std::max(std::min(init_rw_dim, rw_dim), sa_settings.min_rw_dim);
+  }
+
+  // start with an initial temperature, or where the checkpoint being 
+  // resumed left off
+  if (resume_cp == nullptr) {
+    directed_ratio = 0;             // initial T is sampled with random moves
+    T = init_T = initTempSV(50, init_t_fact, rw_dim); // this must come before the first calcCost
+    directed_ratio = sa_settings.directed_ratio;
+    cost = init_cost = chip->calcCost();  // calculate initial cost of the placement
+    // while hot nearly every move is accepted, large nets are left out of 
+    // the deltas until T falls below approx_T
+    approx = sa_settings.approx_net_size > 0;
+  } else {
+    T = resume_cp->T;
+    init_T = resume_cp->init_T;
+    cost = resume_cp->cost;
+    init_cost = resume_cp->init_cost;
+    rw_dim = resume_cp->rw_dim;
+    iterations = resume_cp->iterations;
+    moves = resume_cp->moves;
+    iterations_cost_unchanged = resume_cp->iterations_cost_unchanged;
+    main_done = resume_cp->main_done;
+    abs_zero_cycles = resume_cp->abs_zero_cycles;
+    directed_ratio = resume_cp->directed_ratio;
+    approx = resume_cp->approx;
+    sweep_order = resume_cp->sweep_order;
+    std::istringstream rng_in(resume_cp->rng_state.toStdString());
+    rng_in >> mt;
+    if (resume_cp->rejection_free) {
+      rf_sampler = new RejectionFreeSampler(chip, rw_dim, resume_cp->rf_deltas,
+          resume_cp->rf_stale, resume_cp->rf_blk_stale);
+    }
+  }
   chip->setCost(cost);
-  int rw_dim = std::max(chip->dimX(), chip->dimY());  // initialize range window
-  // main loop
-  while (!exit_cond) {
-    // variables that renew at every point in the schedule
-    int attempts = cycle_attempts;
-    int n_swaps = 0;
-    long cost_accum = 0;
-    long cost_accum_sq = 0;
-    float p_accept_accum = 0;
-    int cost_i = cost;  // record the cost before the iteration to track whether it's changed
-    if (main_done) {
-      // main loop is done, zero temperature finishing phase
-      T = 0;
-    }
-    while (attempts--) {
-      // pick random locs to swap
-      pickLocsToSwap(coord_a, coord_b, bid_a, bid_b, rw_dim);
-
-      // compute cost delta for the swap
-      int cost_delta = chip->calcSwapCostDelta(coord_a.first, coord_a.second,
-          coord_b.first, coord_b.second);
+  approx_T = sa_settings.approx_t_fact * init_T;
+  if (approx) {
+    chip->setApproxNetSize(sa_settings.approx_net_size);
+  }
+  // with a time budget or keep_best, the placement of lowest cost seen at
+  // the end of a step is kept in the chip journal and returned if it beats
+  // the final placement
+  budgeted = sa_settings.time_budget_ms > 0;
+  keep_best = budgeted || sa_settings.keep_best;
+  out_of_time = false;
+  best_cost = cost;
+  T_final = BUDGET_FINAL_T_FACT * init_T;
+  resumed_ms = 0;
+  anneal_start_ms = run_timer.elapsed();
+  if (resume_cp != nullptr && budgeted && resume_cp->time_budget_ms > 0) {
+    // continue the time budget of the checkpointed run instead of starting
+    // it over
+    sa_settings.time_budget_ms = resume_cp->time_budget_ms;
+    resumed_ms = resume_cp->elapsed_ms;
+    anneal_start_ms = resume_cp->anneal_start_ms;
+  }
+  step_ms_cap = (sa_settings.time_budget_ms - anneal_start_ms) / BUDGET_MIN_STEPS;
+  if (keep_best) {
+    if (resume_cp != nullptr && resume_cp->best_locs.size() == chip->numBlocks()) {
+      // the best placement of the checkpointed run is still the one to beat
+      best_cost = resume_cp->best_cost;
+      chip->startJournal(resume_cp->best_locs);
+    } else {
+      chip->startJournal();
+    }
+  }
+  return true;
+}
 
-      // evaluate swap acceptance
-      if (acceptCostDelta(cost_delta, T, p_accept_accum)) {
-        // perform swap and update cost
-        swapLocs(coord_a, coord_b);
-        cost += cost_delta;
-        chip->setCost(cost);
-        // update std calculation stats
-        n_swaps++;
-        cost_accum += cost;
-        cost_accum_sq += pow(cost, 2);
+SAProgress Placer::step(long n_moves)
+{
+  SAProgress progress;
+  while (!done) {
+    if (cancel_requested) {
+      // stop like an exhausted time budget does
+      cancelled = true;
+      finish();
+      break;
+    }
+    if (progress.moves >= n_moves) {
+      break;
+    }
+    if (!in_step) {
+      beginStep();
+    }
+    progress.moves += makeMoves(std::min(n_moves - progress.moves, 
+          (long)STEP_CHUNK_MOVES));
+    if (budgeted) {
+      qint64 elapsed = elapsedMs();
+      out_of_time = elapsed >= sa_settings.time_budget_ms;
+      if (out_of_time || elapsed - step_start_ms >= step_ms_cap) {
+        // cut the step short, the anneal ends with it if out of time
+        step_attempts = step_done;
       }
+    }
+    if (step_done == step_attempts) {
+      // calls end at the end of a temperature step
+      endStep();
+      break;
+    }
+  }
 
-      // emit signal for GUI update
-      if (sa_settings.gui_up == GuiEachSwap) {
-        emit sig_updateGui(chip);
-        emit sig_updateChart(cost, T, -1, -1);
-        if (sa_settings.show_stdout) {
-          qDebug() << tr("Curr stored cost=%1,  Next T=%3, iteration=%4")
-            .arg(cost).arg(T).arg(iterations);
-        }
+  progress.total_moves = moves;
+  progress.iterations = iterations;
+  progress.cost = cost;
+  progress.best_cost = best_cost;
+  progress.T = T;
+  progress.p_accept = last_p_accept;
+  progress.rw_dim = rw_dim;
+  progress.done = done;
+  return progress;
+}
+
+void Placer::beginStep()
+{
+  // variables that renew at every point in the schedule
+  step_attempts = cycle_attempts;
+  if (sa_settings.t_schd == TSchd::LamTUpdate && !main_done) {
+    // few moves are needed when nearly everything or nearly nothing is 
+    // accepted, a full cycle at the plateau
+    float plateau = sa_settings.lam_plateau;
+    lam_target = lamTargetAccept((float)iterations / sa_settings.lam_its, plateau);
+    float moves_fact = (lam_target > plateau) ? (1 - lam_target) / (1 - plateau)
+      : lam_target / plateau;
+    moves_fact = std::max(moves_fact, sa_settings.lam_min_moves_fact);
+    step_attempts = std::max((long)(moves_fact * cycle_attempts), 1L);
+  }
+  step_done = 0;
+  stats = StepStats();
+  step_cost = cost;   // record the cost before the iteration to track whether it's changed
+  if (main_done) {
+    // main loop is done, zero temperature finishing phase
+    T = 0;
+  }
+  if (approx && T < approx_T) {
+    approx = false;
+    chip->setApproxNetSize(-1);
+  }
+  step_T = T;         // T of this step, for compressing the schedule
+  step_start_ms = elapsedMs();
+  rf_wait = -1;
+  resetSweep();
+  if (rf_sampler != nullptr) {
+    rf_sampler->setTemperature(T);
+  }
+  in_step = true;
+}
+
+long Placer::makeMoves(long n_moves)
+{
+  long attempts = std::min(step_attempts - step_done, n_moves);
+  if (rf_sampler != nullptr) {
+    // rejection-free sampling, jump from acceptance to acceptance while
+    // advancing the count of proposals that would have been made. The wait
+    // for an acceptance can carry over to the next call
+    long left = attempts;
+    while (left > 0) {
+      if (rf_wait < 0) {
+        long wait = rf_sampler->drawWait(mt);
+        long step_left = step_attempts - step_done - (attempts - left);
+        // nothing is accepted in the rest of the step if the wait reaches 
+        // past it
+        rf_wait = (wait < 0 || wait > step_left) ? step_left + 1 : wait;
+      }
+      if (rf_wait > left) {
+        rf_wait -= left;
+        break;
+      }
+      left -= rf_wait;
+      rf_wait = -1;
+      qint64 cost_delta;
+      if (rf_sampler->applyCandidate(rf_sampler->drawCandidate(mt), mt, cost_delta)) {
+        cost += cost_delta;
+        chip->setCost(cost);
+        stats.n_swaps++;
+        stats.n_neutral += (cost_delta == 0);
+        stats.cost_accum += cost - step_cost;
+        stats.cost_accum_sq += pow(cost - step_cost, 2);
       }
     }
+  } else if (batched) {
+    batchMoveLoop(attempts, T, rw_dim, cost, stats);
+  } else {
+    (this->*move_loop)(attempts, iterations, T, rw_dim, cost, stats);
+  }
+  step_done += attempts;
+  moves += attempts;
+  return attempts;
+}
 
-    // update annealing schedule and range window
-    iterations++;
-    attempts = cycle_attempts;
-    if (sa_settings.use_rw) {
-      updateRangeWindow(rw_dim, p_accept_accum/cycle_attempts);
+void Placer::endStep()
+{
+  in_step = false;
+  if (rf_sampler != nullptr) {
+    stats.p_accept_accum = rf_sampler->uphillAcceptPerProposal() * step_attempts;
+  }
+  if (approx) {
+    // the accumulated approximate deltas drift from the exact cost
+    cost = chip->calcCost();
+    chip->setCost(cost);
+  }
+
+  // update annealing schedule and range window
+  iterations++;
+  last_p_accept = stats.p_accept_accum/step_attempts;
+  if (sa_settings.use_rw && rf_sampler == nullptr) {
+    updateRangeWindow(rw_dim, last_p_accept);
+  }
+  // update T depending on selected schedule
+  switch (sa_settings.t_schd) {
+    case TSchd::StdDevTUpdate:
+    {
+      // no accepted moves (possible in the rejection-free phase) is treated
+      // like a zero std dev
+      double std_dev = (stats.n_swaps > 0) 
+        ? sqrt(std::max(stats.cost_accum_sq/stats.n_swaps 
+              - pow(stats.cost_accum/stats.n_swaps, 2), 0.)) : 0;
+      T = T * exp(-0.7 * T / std_dev);
+      break;
     }
-    // update T depending on selected schedule
-    switch (sa_settings.t_schd) {
-      case TSchd::StdDevTUpdate:
-      {
-        double std_dev = sqrt(cost_accum_sq/n_swaps - pow(cost_accum/n_swaps, 2));
-        T = T * exp(-0.7 * T / std_dev);
-        break;
-      }
-      case TSchd::ExpDecayTUpdate:
-        T *= sa_settings.decay_b;
-        break;
+    case TSchd::ExpDecayTUpdate:
+      T *= sa_settings.decay_b;
+      break;
+    case TSchd::LamTUpdate:
+    {
+      // cool if accepting more than the target, heat up otherwise. Neutral
+      // moves are accepted at any T and would keep the rate from dropping
+      float accept_rate = (float)(stats.n_swaps - stats.n_neutral) 
+        / std::max(step_attempts - stats.n_neutral, 1L);
+      T *= exp(-LAM_T_GAIN * (accept_rate - lam_target));
+      break;
     }
+  }
 
-    // sanity check
-    if (sa_settings.sanity_check) {
-      int calc_cost = chip->calcCost();
-      if (cost != calc_cost) {
-        qWarning() << tr("Conflicting costs: recorded %1, calculated %2")
-          .arg(cost).arg(calc_cost);
-      }
+  // with a time budget, estimate the steps left at the mean step time so
+  // far and cool at least fast enough to reach T_final in them. The T=0 
+  // countdown runs until abs_zero_cycles drops below 0, so it takes 
+  // abs_zero_cycles + 1 steps after the main loop is done.
+  float budget_steps = 0;
+  if (budgeted && !main_done) {
+    qint64 elapsed = elapsedMs();
+    float step_ms = std::max((float)(elapsed - anneal_start_ms) / iterations, 1e-3f);
+    budget_steps = (sa_settings.time_budget_ms - elapsed) / step_ms 
+      - (abs_zero_cycles + 1);
+    if (budget_steps >= 1 && T > T_final) {
+      T = std::min(T, step_T * (float)pow(T_final / step_T, 1 / budget_steps));
     }
+  }
+
+  // directed moves are of little use while most random moves are accepted
+  if (sa_settings.directed_adaptive) {
+    directed_ratio = sa_settings.directed_ratio * (1 - (float)stats.n_swaps / step_attempts);
+  }
 
-    // terminal status output
+  // switch to rejection-free sampling once nearly every proposal that 
+  // changes the cost is rejected, the range window is fixed from then on
+  if (sa_settings.rejection_free && !approx && rf_sampler == nullptr && sa_settings.use_rw
+      && rw_dim == sa_settings.min_rw_dim && (float)(stats.n_swaps - stats.n_neutral) 
+        / std::max(step_attempts - stats.n_neutral, 1L) < sa_settings.rf_threshold) {
+    rf_sampler = new RejectionFreeSampler(chip, rw_dim);
     if (sa_settings.show_stdout) {
-      qDebug() << tr("Curr stored cost=%1, Next T=%2, iterations=%3, avg P "
-          "accept=%4, range window dim=%5").arg(cost).arg(T).arg(iterations)
-        .arg(p_accept_accum/cycle_attempts).arg(rw_dim);
+      qDebug() << tr("Switching to rejection-free sampling at T=%1").arg(T);
     }
+  }
 
-    // GUI update
-    if (sa_settings.gui_up <= GuiEachAnnealUpdate) {
-      emit sig_updateGui(chip);
-      emit sig_updateChart(cost, T, p_accept_accum/cycle_attempts, rw_dim);
+  // sanity check
+  if (sa_settings.sanity_check) {
+    qint64 calc_cost = chip->calcCost();
+    if (cost != calc_cost) {
+      qWarning() << tr("Conflicting costs: recorded %1, calculated %2")
+        .arg(cost).arg(calc_cost);
     }
+  }
 
-    iterations_cost_unchanged = (cost_i==cost) ? iterations_cost_unchanged+1 : 0;
+  // terminal status output
+  if (sa_settings.show_stdout) {
+    qDebug() << tr("Curr stored cost=%1, Next T=%2, iterations=%3, avg P "
+        "accept=%4, range window dim=%5").arg(cost).arg(T).arg(iterations)
+      .arg(last_p_accept).arg(rw_dim);
+  }
 
-    // evaluate exit conditions
-    if (main_done) {
-      // main loop already done, see if T=0 phase is done yet
-      abs_zero_cycles--;
-      if (abs_zero_cycles < 0) {
-        exit_cond = true;
-      }
-    } else {
-      // evaluate whether main event completion conditions have been met
-      if (iterations == sa_settings.max_its - 1) {
-        // done if max iterations have been reached
-        main_done = true;
-      }
-      if (isnan(T)) {
-        // done if temperature is no longer a value number
-        main_done = true;
-      }
-      if (iterations_cost_unchanged > sa_settings.max_its_cost_unchanged) {
-        // done if cost has remained unchanged for a specified number of cycles
-        main_done = true;
-      }
+  // GUI update
+  if (sa_settings.gui_up <= GuiEachAnnealUpdate) {
+    emit sig_updateGui(chip);
+    emit sig_updateChart(cost, T, last_p_accept, rw_dim);
+  }
+
+  iterations_cost_unchanged = (step_cost==cost) ? iterations_cost_unchanged+1 : 0;
+
+  if (cost < best_cost) {
+    best_cost = cost;
+    if (keep_best) {
+      chip->commitJournal();
     }
   }
 
+  // evaluate exit conditions
+  bool exit_cond = false;
+  if (main_done) {
+    // main loop already done, see if T=0 phase is done yet
+    abs_zero_cycles--;
+    if (abs_zero_cycles < 0) {
+      exit_cond = true;
+    }
+  } else {
+    // evaluate whether main event completion conditions have been met
+    if (iterations == sa_settings.max_its - 1) {
+      // done if max iterations have been reached
+      main_done = true;
+    }
+    if (isnan(T)) {
+      // done if temperature is no longer a value number
+      main_done = true;
+    }
+    if (iterations_cost_unchanged > sa_settings.max_its_cost_unchanged) {
+      // done if cost has remained unchanged for a specified number of cycles
+      main_done = true;
+    }
+    if (budgeted && budget_steps < 1) {
+      // done if only the finishing steps fit into the time budget
+      main_done = true;
+    }
+    if (sa_settings.t_schd == TSchd::LamTUpdate && (iterations >= sa_settings.lam_its
+          || (iterations > 0.65 * sa_settings.lam_its
+            && iterations_cost_unchanged > sa_settings.lam_eq_its))) {
+      // done if the Lam schedule is spent, or if it reached equilibrium in 
+      // the freezing phase
+      main_done = true;
+    }
+    if (main_done && sa_settings.finish_mode != FinishMode::RandomFinish) {
+      // skip the random T=0 cycles, a deterministic finishing phase follows
+      exit_cond = true;
+    }
+  }
+
+  // the time budget is a hard limit
+  if (budgeted && !exit_cond && (out_of_time 
+        || elapsedMs() >= sa_settings.time_budget_ms)) {
+    out_of_time = true;
+    exit_cond = true;
+  }
+
+  if (exit_cond) {
+    finish();
+  } else if (!checkpoint_path.isEmpty() && iterations % checkpoint_interval == 0) {
+    writeCheckpoint();
+  }
+}
+
+void Placer::writeCheckpoint()
+{
+  // the state the next step starts from
+  AnnealCheckpoint cp;
+  cp.nx = chip->dimX();
+  cp.ny = chip->dimY();
+  cp.n_blocks = chip->numBlocks();
+  cp.n_nets = chip->numNets();
+  for (int bid=0; bid<chip->numBlocks(); bid++) {
+    cp.block_locs.append(chip->blockLoc(bid));
+  }
+  cp.cost = cost;
+  cp.init_cost = init_cost;
+  cp.T = T;
+  cp.init_T = init_T;
+  cp.rw_dim = rw_dim;
+  cp.iterations = iterations;
+  cp.moves = moves;
+  cp.iterations_cost_unchanged = iterations_cost_unchanged;
+  cp.main_done = main_done;
+  cp.abs_zero_cycles = abs_zero_cycles;
+  cp.directed_ratio = directed_ratio;
+  cp.approx = approx;
+  cp.rejection_free = rf_sampler != nullptr;
+  if (rf_sampler != nullptr) {
+    cp.rf_deltas = rf_sampler->cachedDeltas();
+    cp.rf_stale = rf_sampler->staleFlags();
+    cp.rf_blk_stale = rf_sampler->staleBlocks();
+  }
+  cp.sweep_order = sweep_order;
+  std::ostringstream rng_out;
+  rng_out << mt;
+  cp.rng_state = QByteArray::fromStdString(rng_out.str());
+  cp.best_cost = best_cost;
+  if (keep_best) {
+    cp.best_locs = chip->rollbackLocs();
+  }
+  cp.time_budget_ms = budgeted ? sa_settings.time_budget_ms : 0;
+  cp.elapsed_ms = elapsedMs();
+  cp.anneal_start_ms = anneal_start_ms;
+  cp.write(checkpoint_path);
+}
+
+void Placer::finish()
+{
+  done = true;
+  in_step = false;
+  if (approx) {
+    // the anneal can end before T falls below approx_T, and a cancelled step
+    // leaves the cost with the approximate deltas
+    chip->setApproxNetSize(-1);
+    cost = chip->calcCost();
+    chip->setCost(cost);
+  }
+
+  if (rf_sampler != nullptr) {
+    if (sa_settings.show_stdout) {
+      qDebug() << tr("Rejection-free sampling evaluated %1 cost deltas")
+        .arg(rf_sampler->evaluations());
+    }
+    delete rf_sampler;
+    rf_sampler = nullptr;
+  }
+
+  // deterministic finishing phase, skipped if stopped early
+  if (out_of_time || cancelled) {
+    if (sa_settings.show_stdout) {
+      qDebug() << tr("%1 after %2 iterations")
+        .arg(cancelled ? "Cancelled" : "Out of time").arg(iterations);
+    }
+  } else if (sa_settings.finish_mode == FinishMode::WindowFinish) {
+    DetailedPlacer dp(chip);
+    cost += dp.refine(sa_settings.dp_win_w, sa_settings.dp_win_h);
+    chip->setCost(cost);
+    evaluations += dp.evaluations();
+    if (sa_settings.show_stdout) {
+      qDebug() << tr("Detailed placement cost=%1 after %2 evaluations")
+        .arg(cost).arg(dp.evaluations());
+    }
+  } else if (sa_settings.finish_mode == FinishMode::GainFinish) {
+    GreedyImprover gi(chip);
+    cost += gi.improve(sa_settings.min_rw_dim);
+    chip->setCost(cost);
+    evaluations += gi.evaluations();
+    if (sa_settings.show_stdout) {
+      qDebug() << tr("Greedy improvement cost=%1 after %2 evaluations")
+        .arg(cost).arg(gi.evaluations());
+    }
+  }
+
+  // return to the best placement seen if it beats the final one
+  if (keep_best) {
+    if (best_cost < cost) {
+      chip->rollbackJournal();
+      cost = best_cost;
+      chip->setCost(cost);
+    }
+    chip->stopJournal();
+  }
+
   if (sa_settings.show_stdout) {
     qDebug() << "End of Simulated Annealing";
   }
@@ -184,9 +674,45 @@ SAResults Placer::runPlacer(const SASettings &t_sa_settings)
     emit sig_updateChart(cost, T, -1, -1);
   }
 
-  SAResults results;
-  results.cost = cost;
-  results.iterations = iterations;
+  run_results.cost = cost;
+  run_results.iterations = iterations + ml_iterations;
+  run_results.moves = moves + ml_moves;
+  run_results.evaluations = evaluations + ml_evaluations;
+  run_results.init_cost = init_cost;
+  run_results.out_of_time = out_of_time;
+  run_results.cancelled = cancelled;
+}
+
+void Placer::setCheckpointing(const QString &path, int interval)
+{
+  checkpoint_path = path;
+  checkpoint_interval = std::max(interval, 1);
+}
+
+SAResults Placer::resumePlacer(const SASettings &t_sa_settings, const QString &path)
+{
+  AnnealCheckpoint cp;
+  if (!chip->isInitialized() || !cp.read(path)) {
+    return SAResults();
+  }
+  if (cp.nx != chip->dimX() || cp.ny != chip->dimY() 
+      || cp.n_blocks != chip->numBlocks() || cp.n_nets != chip->numNets()) {
+    qWarning() << "Checkpoint" << path << "was written for a different problem.";
+    return SAResults();
+  }
+
+  // restore the placement and continue the anneal from it, multilevel runs
+  // are checkpointed in their refinement at the finest level
+  chip->initEmptyPlacements();
+  for (int bid=0; bid<cp.n_blocks; bid++) {
+    chip->setLocBlock(cp.block_locs[bid], bid);
+  }
+  SASettings resume_settings = t_sa_settings.multilevel 
+    ? MultilevelPlacer::refineSettings(t_sa_settings) : t_sa_settings;
+  resume_settings.init_place = InitPlace::ExistingInit;
+  resume_cp = &cp;
+  SAResults results = runPlacer(resume_settings);
+  resume_cp = nullptr;
   return results;
 }
 
@@ -194,22 +720,38 @@ void Placer::initBlockPos()
 {
   int nx = chip->dimX();
   int ny = chip->dimY();
+  if (2 * (long)chip->numBlocks() <= (long)nx * ny) {
+    // at most half of the cells get occupied, draw random cells until a free 
+    // one is found (at most two draws per block on average) so that memory 
+    // scales with the block count rather than the chip area
+    std::uniform_int_distribution<int> cell_dist(0, nx*ny-1);
+    for (int bid=0; bid<chip->numBlocks(); bid++) {
+      QPair<int,int> loc;
+      do {
+        loc = ind_coord(cell_dist(mt), nx);
+      } while (chip->blockIdAt(loc) >= 0);
+      chip->setLocBlock(loc, bid);
+    }
+    return;
+  }
   // list of unoccupied grid indices
-  QList<int> grid_inds;
+  QVector<int> grid_inds(nx*ny);
   for (int gid=0; gid<nx*ny; gid++) {
-    grid_inds.append(gid);
+    grid_inds[gid] = gid;
   }
-  // place block by block
+  // place block by block, taken indices are swapped to the end of the list so
+  // large problems don't pay for removals from the middle
+  int n_free = grid_inds.size();
   for (int bid=0; bid<chip->numBlocks(); bid++) {
-    std::uniform_int_distribution<int> dis(0, grid_inds.size()-1);
+    std::uniform_int_distribution<int> dis(0, n_free-1);
     int rand_ind = dis(mt);
     QPair<int,int> loc = ind_coord(grid_inds[rand_ind], nx);
     chip->setLocBlock(loc, bid);
-    grid_inds.removeAt(rand_ind);
+    std::swap(grid_inds[rand_ind], grid_inds[--n_free]);
   }
 }
 
-float Placer::initTempSV(int rand_moves, float T_fact)
+float Placer::initTempSV(int rand_moves, float T_fact, int rw_dim)
 {
   long cost_accum = 0;
   long cost_accum_sq = 0;
@@ -217,10 +759,14 @@ float Placer::initTempSV(int rand_moves, float T_fact)
   int bid_a, bid_b;                 // block IDs a and b for the swap
   for (int i=0; i<rand_moves; i++) {
     // pick random locs to swap
-    pickLocsToSwap(coord_a, coord_b, bid_a, bid_b, std::max(chip->dimX(), chip->dimY()));
-    int cost_delta = chip->calcSwapCostDelta(coord_a.first, coord_a.second,
+    pickLocsToSwap(runtimeMoveOpts(), coord_a, coord_b, bid_a, bid_b, rw_dim);
+    qint64 cost_delta = chip->calcSwapCostDelta(coord_a.first, coord_a.second,
         coord_b.first, coord_b.second);
-    swapLocs(coord_a, coord_b);
+    // random placements may as well be randomized further, other starting 
+    // placements are kept intact
+    if (sa_settings.init_place == InitPlace::RandomInit) {
+      swapLocs(coord_a, coord_b);
+    }
     // record stats
     cost_accum += cost_delta;
     cost_accum_sq += pow(cost_delta, 2);
@@ -229,46 +775,307 @@ float Placer::initTempSV(int rand_moves, float T_fact)
   return stddev * T_fact;
 }
 
-void Placer::pickLocsToSwap(QPair<int,int> &coord_a, QPair<int,int> &coord_b,
-    int &bid_a, int &bid_b, int rw_dim)
+template<class Opts>
+void Placer::pickLocsToSwap(const Opts &opts, QPair<int,int> &coord_a,
+    QPair<int,int> &coord_b, int &bid_a, int &bid_b, int rw_dim)
 {
+  // the source block is kept when redrawing b so that sweeps visit every 
+  // block
+  bid_a = nextSourceBlock(opts);
+  coord_a = chip->blockLoc(bid_a);
   bool chosen = false;
   while (!chosen) {
-    // choose random block ID as a and any location as b, eligible if not equal
-    bid_a = bid_dist(mt);
-    coord_a = chip->blockLoc(bid_a);
-    pickCoordFromRangeWindow(coord_a, coord_b, rw_dim);
+    // choose any location as b, eligible if not equal to that of a
+    if (opts.directed && directed_ratio > 0 && prob_dist(mt) < directed_ratio) {
+      pickDirectedCoord(opts, bid_a, coord_b, rw_dim);
+    } else {
+      pickCoordFromRangeWindow(opts, coord_a, coord_b, rw_dim);
+    }
     chosen = (coord_a != coord_b);
   }
   bid_b = chip->blockIdAt(coord_b);
 }
 
-void Placer::pickCoordFromRangeWindow(const QPair<int,int> &coord_center,
-    QPair<int,int> &picked_coord, int rw_dim)
+template<class Opts>
+void Placer::moveLoop(const Opts &opts, long attempts, int iteration, float T,
+    int rw_dim, qint64 &cost, StepStats &stats)
 {
-  // if not using range window, or if the window covers entire chip, pick anywhere
-  if (!sa_settings.use_rw || rw_dim == std::max(chip->dimX(), chip->dimY())) {
-    picked_coord = ind_coord(ind_dist(mt), chip->dimX());
-    return;
+  QPair<int,int> coord_a, coord_b;  // coordinates to be swapped
+  int bid_a, bid_b;                 // block IDs a and b for the swap
+  QVector<QPair<int,int>> move_from, move_to; // cells of compound moves
+  while (attempts--) {
+    // pick a compound move with the configured probabilities, or random 
+    // locs to swap otherwise
+    qint64 cost_delta;
+    bool compound = opts.compound && pickCompoundMove(opts, prob_dist(mt),
+        move_from, move_to, rw_dim);
+    if (compound) {
+      cost_delta = chip->calcMoveCostDelta(move_from, move_to);
+    } else {
+      pickLocsToSwap(opts, coord_a, coord_b, bid_a, bid_b, rw_dim);
+      cost_delta = chip->calcSwapCostDelta(coord_a.first, coord_a.second,
+          coord_b.first, coord_b.second);
+    }
+
+    stats.n_neutral += (cost_delta == 0);
+
+    // evaluate swap acceptance
+    if (acceptCostDelta(cost_delta, T, stats.p_accept_accum)) {
+      // perform swap and update cost
+      if (compound) {
+        chip->applyMove(move_from, move_to);
+      } else {
+        swapLocs(coord_a, coord_b);
+      }
+      cost += cost_delta;
+      chip->setCost(cost);
+      // update std calculation stats
+      stats.n_swaps++;
+      stats.cost_accum += cost - step_cost;
+      stats.cost_accum_sq += pow(cost - step_cost, 2);
+    }
+
+    // emit signal for GUI update
+    if (opts.gui_each_swap) {
+      emit sig_updateGui(chip);
+      emit sig_updateChart(cost, T, -1, -1);
+      if (opts.show_stdout) {
+        qDebug() << tr("Curr stored cost=%1,  Next T=%3, iteration=%4")
+          .arg(cost).arg(T).arg(iteration);
+      }
+    }
   }
+}
 
-  // otherwise, find the area of coverage
-  QRect rw_rect(coord_center.first - std::floor(rw_dim/2), coord_center.second - std::floor(rw_dim/2),
-      std::min(rw_dim, chip->dimX()), std::min(rw_dim, chip->dimY()));
-  if (rw_rect.top() < 0) {
-    rw_rect.moveTop(0);
+void Placer::genericMoveLoop(long attempts, int iteration, float T,
+    int rw_dim, qint64 &cost, StepStats &stats)
+{
+  moveLoop(runtime_opts, attempts, iteration, T, rw_dim, cost, stats);
+}
+
+template<class Opts>
+void Placer::specializedMoveLoop(long attempts, int iteration, float T,
+    int rw_dim, qint64 &cost, StepStats &stats)
+{
+  moveLoop(Opts(), attempts, iteration, T, rw_dim, cost, stats);
+}
+
+void Placer::batchMoveLoop(long attempts, float T, int rw_dim, qint64 &cost,
+    StepStats &stats)
+{
+  if (block_stamps.size() != chip->numBlocks() 
+      || net_stamps.size() != chip->numNets()) {
+    block_stamps.fill(0, chip->numBlocks());
+    net_stamps.fill(0, chip->numNets());
+    batch_stamp = 0;
+  }
+  QPair<int,int> coord_a, coord_b;  // coordinates to be swapped
+  int bid_a, bid_b;                 // block IDs a and b for the swap
+  while (attempts > 0) {
+    // collect swaps until one conflicts with the batch, the conflicting swap 
+    // was picked from the placement before the batch and is dropped
+    batch_stamp++;
+    batch.clear();
+    batch_free_cells.clear();
+    while (batch.size() < sa_settings.batch_size && attempts > 0) {
+      pickLocsToSwap(runtime_opts, coord_a, coord_b, bid_a, bid_b, rw_dim);
+      if (!reserveBatchSwap(coord_a, coord_b, bid_a, bid_b)) {
+        break;
+      }
+      sp::SwapCandidate swap = {coord_a.first, coord_a.second, 
+        coord_b.first, coord_b.second};
+      batch.append(swap);
+      attempts--;
+    }
+
+    // the swaps are independent, so the deltas hold in any order
+    chip->calcSwapCostDeltas(batch, batch_deltas);
+    for (int i=0; i<batch.size(); i++) {
+      qint64 cost_delta = batch_deltas[i];
+      stats.n_neutral += (cost_delta == 0);
+      if (acceptCostDelta(cost_delta, T, stats.p_accept_accum)) {
+        swapLocs(qMakePair(batch[i].x1, batch[i].y1), 
+            qMakePair(batch[i].x2, batch[i].y2));
+        cost += cost_delta;
+        chip->setCost(cost);
+        stats.n_swaps++;
+        stats.cost_accum += cost - step_cost;
+        stats.cost_accum_sq += pow(cost - step_cost, 2);
+      }
+    }
+  }
+}
+
+bool Placer::reserveBatchSwap(const QPair<int,int> &coord_a,
+    const QPair<int,int> &coord_b, int bid_a, int bid_b)
+{
+  // occupied cells are marked through their blocks and the few empty cells 
+  // of the batch are listed, so the marks scale with the block count rather
+  // than the chip area
+  int nx = chip->dimX();
+  int cell_a = coord_a.first + coord_a.second * nx;
+  int cell_b = coord_b.first + coord_b.second * nx;
+  if ((bid_a == -1 && batch_free_cells.contains(cell_a))
+      || (bid_b == -1 && batch_free_cells.contains(cell_b))) {
+    return false;
+  }
+  sp::Graph *graph = chip->getGraph();
+  for (int bid : {bid_a, bid_b}) {
+    if (bid == -1) {
+      continue;
+    }
+    if (block_stamps[bid] == batch_stamp) {
+      return false;
+    }
+    for (int net_id : graph->blockNets(bid)) {
+      if (net_stamps[net_id] == batch_stamp) {
+        return false;
+      }
+    }
+  }
+  // the two blocks may share nets, so marking only starts after all checks
+  if (bid_a == -1) {
+    batch_free_cells.append(cell_a);
+  }
+  if (bid_b == -1) {
+    batch_free_cells.append(cell_b);
+  }
+  for (int bid : {bid_a, bid_b}) {
+    if (bid == -1) {
+      continue;
+    }
+    block_stamps[bid] = batch_stamp;
+    for (int net_id : graph->blockNets(bid)) {
+      net_stamps[net_id] = batch_stamp;
+    }
+  }
+  return true;
+}
+
+Placer::RuntimeMoveOpts Placer::runtimeMoveOpts() const
+{
+  RuntimeMoveOpts opts;
+  opts.gui_each_swap = (sa_settings.gui_up == GuiEachSwap);
+  opts.show_stdout = sa_settings.show_stdout;
+  opts.use_rw = sa_settings.use_rw;
+  opts.compound = (sa_settings.p_shift + sa_settings.p_rotate 
+      + sa_settings.p_cluster > 0);
+  opts.directed = (sa_settings.directed_ratio > 0);
+  opts.sanity_check = sa_settings.sanity_check;
+  opts.block_order = sa_settings.block_order;
+  return opts;
+}
+
+Placer::MoveLoop Placer::selectMoveLoop(const RuntimeMoveOpts &opts)
+{
+  if (opts.gui_each_swap) {
+    return &Placer::genericMoveLoop;
+  }
+  // the flags are fixed one by one, 48 instantiations in total
+  const bool flags[4] = {opts.use_rw, opts.compound, opts.directed, 
+    opts.sanity_check};
+  return selectFlagLoop<>(flags, opts.block_order);
+}
+
+template<bool... Flags>
+typename std::enable_if<(sizeof...(Flags) < 4), Placer::MoveLoop>::type
+  Placer::selectFlagLoop(const bool *flags, BlockOrder order)
+{
+  return flags[sizeof...(Flags)] ? selectFlagLoop<Flags..., true>(flags, order)
+    : selectFlagLoop<Flags..., false>(flags, order);
+}
+
+template<bool... Flags>
+typename std::enable_if<sizeof...(Flags) == 4, Placer::MoveLoop>::type
+  Placer::selectFlagLoop(const bool *, BlockOrder order)
+{
+  switch (order) {
+    case BlockOrder::ShuffledSweep:
+      return &Placer::specializedMoveLoop<
+        StaticMoveOpts<Flags..., BlockOrder::ShuffledSweep>>;
+    case BlockOrder::LocalitySweep:
+      return &Placer::specializedMoveLoop<
+        StaticMoveOpts<Flags..., BlockOrder::LocalitySweep>>;
+    default:
+      return &Placer::specializedMoveLoop<
+        StaticMoveOpts<Flags..., BlockOrder::RandomOrder>>;
   }
-  if (rw_rect.left() < 0) {
-    rw_rect.moveLeft(0);
+}
+
+void Placer::resetSweep()
+{
+  if (!source_blocks.isEmpty()) {
+    return;
   }
-  if (rw_rect.right() >= chip->dimX()) {
-    rw_rect.moveRight(chip->dimX()-1);
+  switch (sa_settings.block_order) {
+    case BlockOrder::ShuffledSweep:
+      if (sweep_order.size() != chip->numBlocks()) {
+        sweep_order.resize(chip->numBlocks());
+        std::iota(sweep_order.begin(), sweep_order.end(), 0);
+      }
+      std::shuffle(sweep_order.begin(), sweep_order.end(), mt);
+      sweep_pos = 0;
+      break;
+    case BlockOrder::LocalitySweep:
+      sweep_pos = ind_dist(mt);
+      break;
+    default:
+      break;
+  }
+}
+
+template<class Opts>
+int Placer::nextSourceBlock(const Opts &opts)
+{
+  if (!source_blocks.isEmpty()) {
+    return source_blocks[bid_dist(mt)];
+  }
+  switch (opts.block_order) {
+    case BlockOrder::ShuffledSweep:
+      if (sweep_pos >= sweep_order.size()) {
+        resetSweep();
+      }
+      return sweep_order[sweep_pos++];
+    case BlockOrder::LocalitySweep:
+    {
+      // walk the cells row by row, alternating direction, until one holds a 
+      // block; there is at least one block so this terminates
+      int nx = chip->dimX();
+      int n_cells = nx * chip->dimY();
+      while (true) {
+        int y = sweep_pos / nx;
+        int x = (y % 2 == 0) ? sweep_pos % nx : nx - 1 - sweep_pos % nx;
+        sweep_pos = (sweep_pos + 1) % n_cells;
+        int bid = chip->blockIdAt(qMakePair(x, y));
+        if (bid >= 0) {
+          return bid;
+        }
+      }
+    }
+    default:
+      return bid_dist(mt);
   }
-  if (rw_rect.bottom() >= chip->dimY()) {
-    rw_rect.moveBottom(chip->dimY()-1);
+}
+
+template<class Opts>
+void Placer::pickCoordFromRangeWindow(const Opts &opts, 
+    const QPair<int,int> &coord_center, QPair<int,int> &picked_coord,
+    int rw_dim)
+{
+  // if not using range window, or if the window covers entire chip, pick anywhere
+  if (!opts.use_rw || rw_dim == std::max(chip->dimX(), chip->dimY())) {
+    // most cells of sparse grids are empty and far from any block, so the 
+    // targets are drawn next to the blocks instead
+    if (!sparse_sites || !pickSparseSite(coord_center, picked_coord)) {
+      picked_coord = ind_coord(ind_dist(mt), chip->dimX());
+    }
+    return;
   }
+
+  // otherwise, find the area of coverage
+  QRect rw_rect = chip->rangeWindow(coord_center, rw_dim);
   // sanity check that the range window is fully contained in the chip
-  if (sa_settings.sanity_check) {
+  if (opts.sanity_check) {
     QRect chip_rect(0, 0, chip->dimX(), chip->dimY());
     if (!chip_rect.contains(rw_rect)) {
       qWarning() << "Range window rect " << rw_rect << " not completely "
@@ -290,7 +1097,7 @@ void Placer::pickCoordFromRangeWindow(const QPair<int,int> &coord_center,
   picked_coord.second += rw_rect.top();
 
   // sanity check that the chosen coordinates fall within the chip
-  if (sa_settings.sanity_check) {
+  if (opts.sanity_check) {
     QRect chip_rect(0, 0, chip->dimX(), chip->dimY());
     if (!chip_rect.contains(QPoint(picked_coord.first, picked_coord.second))) {
       qWarning() << "Coordinates that fall outside the chip have been chosen.";
@@ -299,6 +1106,174 @@ void Placer::pickCoordFromRangeWindow(const QPair<int,int> &coord_center,
 
 }
 
+bool Placer::pickSparseSite(const QPair<int,int> &coord_center,
+    QPair<int,int> &picked_coord)
+{
+  std::uniform_int_distribution<int> offset_dist(-SPARSE_SITE_RADIUS, 
+      SPARSE_SITE_RADIUS);
+  for (int i=0; i<SPARSE_SITE_TRIES; i++) {
+    QPair<int,int> loc = chip->blockLoc(site_dist(mt));
+    picked_coord.first = loc.first + offset_dist(mt);
+    picked_coord.second = loc.second + offset_dist(mt);
+    if (picked_coord.first >= 0 && picked_coord.first < chip->dimX()
+        && picked_coord.second >= 0 && picked_coord.second < chip->dimY()
+        && picked_coord != coord_center) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<class Opts>
+void Placer::pickDirectedCoord(const Opts &opts, int bid, 
+    QPair<int,int> &picked_coord, int rw_dim)
+{
+  // coordinates of the blocks sharing nets with this block, large nets say 
+  // little about where the block should go and are skipped
+  sp::Graph *graph = chip->getGraph();
+  conn_xs.clear();
+  conn_ys.clear();
+  for (int net_id : graph->blockNets(bid)) {
+    const QList<int> &net = graph->getNet(net_id);
+    if (net.size() > MAX_DIRECTED_NET_SIZE) {
+      continue;
+    }
+    for (int n_bid : net) {
+      if (n_bid != bid) {
+        QPair<int,int> loc = chip->blockLoc(n_bid);
+        conn_xs.append(loc.first);
+        conn_ys.append(loc.second);
+      }
+    }
+  }
+  QPair<int,int> coord_a = chip->blockLoc(bid);
+  if (conn_xs.isEmpty()) {
+    pickCoordFromRangeWindow(opts, coord_a, picked_coord, rw_dim);
+    return;
+  }
+
+  // median location with a small random offset so that the target cell does
+  // not keep bouncing the same two blocks, clamped to the range window
+  int mid = conn_xs.size() / 2;
+  std::nth_element(conn_xs.begin(), conn_xs.begin() + mid, conn_xs.end());
+  std::nth_element(conn_ys.begin(), conn_ys.begin() + mid, conn_ys.end());
+  std::uniform_int_distribution<int> offset_dist(-1, 1);
+  QRect rw_rect = (opts.use_rw) ? chip->rangeWindow(coord_a, rw_dim)
+    : QRect(0, 0, chip->dimX(), chip->dimY());
+  picked_coord.first = std::max(std::min(conn_xs[mid] + offset_dist(mt), 
+        rw_rect.right()), rw_rect.left());
+  picked_coord.second = std::max(std::min(conn_ys[mid] + offset_dist(mt),
+        rw_rect.bottom()), rw_rect.top());
+  if (picked_coord == coord_a) {
+    pickCoordFromRangeWindow(opts, coord_a, picked_coord, rw_dim);
+  }
+}
+
+template<class Opts>
+bool Placer::pickCompoundMove(const Opts &opts, float r, 
+    QVector<QPair<int,int>> &from, QVector<QPair<int,int>> &to, int rw_dim)
+{
+  if (r >= sa_settings.p_shift + sa_settings.p_rotate + sa_settings.p_cluster) {
+    return false;
+  }
+  from.clear();
+  to.clear();
+  QPair<int,int> coord_a = chip->blockLoc(nextSourceBlock(opts));
+  if (r < sa_settings.p_shift) {
+    // shift the segment between the block and the nearest empty cell in a 
+    // random direction by one cell, the block's cell becomes empty
+    static const int dirs[4][2] = {{1,0}, {-1,0}, {0,1}, {0,-1}};
+    std::uniform_int_distribution<int> dir_dist(0, 3);
+    const int *dir = dirs[dir_dist(mt)];
+    int max_len = std::min(std::max(rw_dim/2, 1), MAX_SHIFT_LEN);
+    QPair<int,int> cell = coord_a;
+    for (int len=0; len<=max_len; len++) {
+      if (cell.first < 0 || cell.first >= chip->dimX() 
+          || cell.second < 0 || cell.second >= chip->dimY()) {
+        return false;
+      }
+      from.append(cell);
+      if (chip->blockIdAt(cell) == -1) {
+        to = from.mid(1);
+        to.append(coord_a);
+        return true;
+      }
+      cell = qMakePair(cell.first + dir[0], cell.second + dir[1]);
+    }
+    return false;
+  } else if (r < sa_settings.p_shift + sa_settings.p_rotate) {
+    // rotate the contents of the block's cell and two other cells
+    QPair<int,int> coord_b, coord_c;
+    pickCoordFromRangeWindow(opts, coord_a, coord_b, rw_dim);
+    pickCoordFromRangeWindow(opts, coord_a, coord_c, rw_dim);
+    if (coord_b == coord_c || coord_b == coord_a || coord_c == coord_a) {
+      return false;
+    }
+    from << coord_a << coord_b << coord_c;
+    to << coord_b << coord_c << coord_a;
+    return true;
+  }
+
+  // translate the block and up to two blocks sharing small nets with it 
+  // (that are within the range window) by the offset to a random cell
+  sp::Graph *graph = chip->getGraph();
+  QRect rw_rect = chip->rangeWindow(coord_a, rw_dim);
+  QList<int> candidates;
+  int bid_a = chip->blockIdAt(coord_a);
+  for (int net_id : graph->blockNets(bid_a)) {
+    const QList<int> &net = graph->getNet(net_id);
+    if (net.size() > MAX_CLUSTER_NET_SIZE) {
+      continue;
+    }
+    for (int n_bid : net) {
+      QPair<int,int> loc = chip->blockLoc(n_bid);
+      if (n_bid != bid_a && rw_rect.contains(loc.first, loc.second)
+          && !candidates.contains(n_bid)) {
+        candidates.append(n_bid);
+      }
+    }
+  }
+  QVector<QPair<int,int>> src;
+  src.append(coord_a);
+  for (int i=0; i<MAX_CLUSTER_SIZE-1 && !candidates.isEmpty(); i++) {
+    std::uniform_int_distribution<int> cand_dist(0, candidates.size()-1);
+    src.append(chip->blockLoc(candidates.takeAt(cand_dist(mt))));
+  }
+  QPair<int,int> target;
+  pickCoordFromRangeWindow(opts, coord_a, target, rw_dim);
+  int dx = target.first - coord_a.first;
+  int dy = target.second - coord_a.second;
+  if (dx == 0 && dy == 0) {
+    return false;
+  }
+  QVector<QPair<int,int>> dst;
+  for (const QPair<int,int> &cell : src) {
+    QPair<int,int> moved(cell.first + dx, cell.second + dy);
+    if (moved.first < 0 || moved.first >= chip->dimX() 
+        || moved.second < 0 || moved.second >= chip->dimY()) {
+      return false;
+    }
+    dst.append(moved);
+  }
+  // the cluster moves to the destination cells, whatever occupied the 
+  // destination cells outside of the cluster takes the vacated cells
+  from = src;
+  to = dst;
+  QVector<QPair<int,int>> vacated;
+  for (const QPair<int,int> &cell : src) {
+    if (!dst.contains(cell)) {
+      vacated.append(cell);
+    }
+  }
+  for (const QPair<int,int> &cell : dst) {
+    if (!src.contains(cell)) {
+      from.append(cell);
+      to.append(vacated.takeFirst());
+    }
+  }
+  return true;
+}
+
 void Placer::swapLocs(const QPair<int,int> &coord_a, const QPair<int,int> &coord_b)
 {
   int bid_a = chip->blockIdAt(coord_a);
@@ -306,7 +1281,7 @@ void Placer::swapLocs(const QPair<int,int> &coord_a, const QPair<int,int> &coord
   chip->setLocBlock(coord_b, bid_a);
 }
 
-bool Placer::acceptCostDelta(int delta, float T, float &p_accept_accum)
+bool Placer::acceptCostDelta(qint64 delta, float T, float &p_accept_accum)
 {
   // always accept if lower cost
   if (delta <= 0) {
@@ -318,6 +1293,18 @@ bool Placer::acceptCostDelta(int delta, float T, float &p_accept_accum)
   return prob_dist(mt) < prob;
 }
 
+float Placer::lamTargetAccept(float progress, float plateau)
+{
+  if (progress < 0.15) {
+    // quickly drop from accepting everything to the plateau
+    return plateau + (1 - plateau) * pow(560, -progress / 0.15);
+  } else if (progress < 0.65) {
+    return plateau;
+  }
+  // exponential decay towards freezing
+  return plateau * pow(440, -(progress - 0.65) / 0.35);
+}
+
 void Placer::updateRangeWindow(int &rw_dim, float p_accept)
 {
   int max_dim = std::max(chip->dimX(), chip->dimY());
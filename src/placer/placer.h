@@ -9,9 +9,13 @@
 #ifndef _PC_PLACER_H_
 #define _PC_PLACER_H_
 
+#include <QElapsedTimer>
 #include <QObject>
+#include <atomic>
 #include <random>
+#include <type_traits>
 #include "spatial.h"
+#include "checkpoint.h"
 
 // placer namespace
 namespace pc{
@@ -21,22 +25,72 @@ namespace pc{
     //! Exponential decay temperature.
     ExpDecayTUpdate,
     //! Dynamic temperature update.
-    StdDevTUpdate
+    StdDevTUpdate,
+    //! Modified Lam schedule, T and moves per step track a target acceptance
+    //! rate trajectory.
+    LamTUpdate
   };
   enum GuiUpdate {GuiEachSwap, GuiEachAnnealUpdate, GuiFinalOnly};
 
+  //! The initial placement method.
+  enum class InitPlace {
+    //! Place blocks onto random grid locations.
+    RandomInit,
+    //! Start from the placement currently on the chip.
+    ExistingInit,
+    //! Analytical quadratic wirelength placement, legalized onto the grid.
+    QuadraticInit,
+    //! Recursive min-cut bisection placement.
+    MinCutInit
+  };
+
+  //! The zero temperature finishing phase.
+  enum class FinishMode {
+    //! Keep making random swaps at T=0 for a few cycles.
+    RandomFinish,
+    //! Exhaustive sliding window permutation until no window improves.
+    WindowFinish,
+    //! Greedy best-gain swaps within min_rw_dim until a local minimum.
+    GainFinish
+  };
+
+  //! The order in which source blocks of moves are picked.
+  enum class BlockOrder {
+    //! Pick a uniformly random block for every move.
+    RandomOrder,
+    //! Sweep through a random permutation of the blocks, reshuffled at every 
+    //! temperature step.
+    ShuffledSweep,
+    //! Sweep through the grid in serpentine row order from a random start 
+    //! cell, so consecutive moves touch nearby blocks and nets.
+    LocalitySweep
+  };
+
   //! Simulated annealer settings.
   struct SASettings
   {
     // GUI settings
     GuiUpdate gui_up=GuiEachAnnealUpdate; //!< GUI update frequency.
 
+    // initial placement settings
+    InitPlace init_place=InitPlace::RandomInit; //!< Initial placement method.
+    float init_t_fact=20;   //!< Initial T is this factor times the std dev of sampled move costs.
+    int init_rw_dim=-1;     //!< Initial range window dimension, -1 to cover the whole chip.
+    float constructive_t_fact=2;  //!< init_t_fact used when starting from a constructive placement.
+    int constructive_rw_dim=11;   //!< init_rw_dim used when starting from a constructive placement.
+    int qp_rounds=5;        //!< Solve-and-legalize rounds of the quadratic initial placement.
+    bool skip_anneal=false; //!< Only compute the initial placement (fast mode).
+
     // annealing schedule settings
     TSchd t_schd=TSchd::StdDevTUpdate;  //!< Temperature schedule.
     float decay_b=0.995;            //!< Base factor for exponential decay T.
     float swap_fact=25;             //!< swap_fact * n_blocks^(4/3) moves are made per cycle
     int max_its=3000;               //!< maximum iterations
     int max_its_cost_unchanged=200; //!< exit main loop if cost unchanged for this many cycles
+    int lam_its=500;                //!< Modified Lam schedule length in steps.
+    float lam_plateau=0.2;          //!< Target acceptance rate of the Lam plateau phase.
+    float lam_min_moves_fact=0.1;   //!< Lower bound of the Lam moves per step factor.
+    int lam_eq_its=10;              //!< Lam exits when frozen and cost unchanged for this many steps.
 
     // range window params
     bool use_rw=true;     //!< Specify whether range window should be used.
@@ -45,18 +99,75 @@ namespace pc{
     int min_rw_dim=5;     //!< Do not reduce range window dimensions below this dim.
     int rw_dim_delta=10;  //!< Increase or reduce range window dimensions by this much.
 
+    // move generation params
+    float directed_ratio=0;     //!< Fraction of moves targeting the median of the block's connected blocks.
+    bool directed_adaptive=false; //!< Scale directed_ratio by the rejection rate of the last step.
+    float p_shift=0;    //!< Probability of shifting a segment into the nearest empty cell.
+    float p_rotate=0;   //!< Probability of rotating the contents of three cells.
+    float p_cluster=0;  //!< Probability of translating a small connected cluster.
+    BlockOrder block_order=BlockOrder::RandomOrder; //!< Order of picking move source blocks.
+    int batch_size=1;   //!< Evaluate up to this many cell and net disjoint swaps together, 1 to evaluate moves one by one.
+
+    // rejection-free sampling params
+    bool rejection_free=false;  //!< Switch to rejection-free sampling at low acceptance.
+    float rf_threshold=0.001;   //!< Switch once fewer than this fraction of cost changing proposals are accepted at min_rw_dim.
+
+    // approximate cost params
+    int approx_net_size=0;      //!< Leave nets above this pin count out of move deltas while hot, 0 to always use exact deltas.
+    float approx_t_fact=0.2;    //!< Use exact deltas once T falls below this factor of the initial T.
+
+    // finishing phase params
+    FinishMode finish_mode=FinishMode::RandomFinish; //!< Zero temperature finishing phase.
+    int dp_win_w=3;       //!< Width of the detailed placement window.
+    int dp_win_h=2;       //!< Height of the detailed placement window.
+
+    // multilevel params
+    bool multilevel=false;        //!< Coarsen, anneal the coarsest level, then project and refine.
+    int ml_coarsest_blocks=300;   //!< Stop coarsening at or below this block count.
+    float ml_refine_t_fact=0.5;   //!< init_t_fact of the refinement anneals.
+    int ml_refine_rw_dim=5;       //!< init_rw_dim of the refinement anneals.
+    float ml_refine_swap_fact=2;  //!< swap_fact of the refinement anneals.
+    int ml_refine_its=100;        //!< max_its of the refinement anneals.
+
+    // time budget params
+    int time_budget_ms=0;   //!< Wall time budget of runPlacer, 0 for none. The schedule is compressed to fit and the best placement is returned if time runs out.
+
     // other runtime params
     bool sanity_check=false;  //!< Run additional sanity checks to help find bugs.
+    bool keep_best=false;     //!< Return the lowest cost placement seen at the end of a step (always done with a time budget).
+    bool specialized_loop=true; //!< Run the move loop compiled for the settings instead of the generic one.
     bool show_stdout=false;   //!< Whether to show terminal output
   };
 
   //! Results to return.
   struct SAResults
   {
-    int cost=-1;              //!< Final cost of the layout.
+    qint64 cost=-1;           //!< Final cost of the layout.
     int iterations=-1;        //!< Total iterations used.
+    long moves=-1;            //!< Total moves attempted.
+    long evaluations=0;       //!< Cost evaluations of the deterministic finishing phase, not counted as moves.
+    qint64 init_cost=-1;      //!< Cost of the initial placement.
+    qint64 runtime_ms=-1;     //!< Wall time of the run, only set by the benchmarker.
+    bool out_of_time=false;   //!< Whether the time budget ran out before the anneal finished.
+    bool cancelled=false;     //!< Whether the anneal was stopped by Placer::cancel.
   };
 
+  //! Progress of a run after a call to Placer::step.
+  struct SAProgress
+  {
+    long moves=0;             //!< Moves attempted by the call.
+    long total_moves=0;       //!< Moves attempted by the run so far.
+    int iterations=0;         //!< Temperature steps completed.
+    qint64 cost=-1;           //!< Current cost.
+    qint64 best_cost=-1;      //!< Lowest cost at the end of a temperature step so far.
+    float T=0;                //!< Temperature of the current or next step.
+    float p_accept=-1;        //!< Mean acceptance probability of the last completed step, -1 before the first.
+    int rw_dim=-1;            //!< Current range window dimension.
+    bool done=false;          //!< Whether the run is finished.
+  };
+
+  class RejectionFreeSampler;
+
   //! Simulated annealing placement algorithm.
   class Placer : public QObject
   {
@@ -67,46 +178,248 @@ namespace pc{
     Placer(sp::Chip *);
 
     //! Destructor.
-    ~Placer() {};
+    ~Placer();
 
-    //! Run the placer.
+    //! Run the placer, a loop over init and step.
     SAResults runPlacer(const SASettings &sa_settings);
 
-    //! Place blocks onto random grid locations.
+    //! \brief Prepare a run to be made with step.
+    //!
+    //! Computes the initial placement (after placing the coarse levels of 
+    //! multilevel runs) and the initial temperature. An unfinished previous
+    //! run is dropped. Returns false if the chip is uninitialized. The run 
+    //! is already done if the anneal is skipped.
+    bool init(const SASettings &sa_settings);
+
+    //! \brief Continue the run by up to n_moves move attempts.
+    //!
+    //! Returns early at the end of a temperature step, after which the 
+    //! schedule and range window are updated, the exit conditions evaluated
+    //! and checkpoints written as in runPlacer. The finishing phase is run 
+    //! and the results set once the anneal ends. The time budget is wall 
+    //! time since init, including the time between calls.
+    SAProgress step(long n_moves);
+
+    //! Return whether the run is finished or there is none.
+    bool isDone() const {return done;}
+
+    //! Stop the anneal within a few thousand moves of a running step call, 
+    //! or in the next call otherwise (which may make no moves). The run 
+    //! then ends as if the time budget had run out. Can be called from 
+    //! another thread.
+    void cancel() {cancel_requested = true;}
+
+    //! Return the results of the last finished run.
+    SAResults results() const {return run_results;}
+
+    //! Place blocks onto random grid locations of an empty chip.
     void initBlockPos();
 
+    //! Draw the source blocks of the moves of the following runs at random 
+    //! from the given blocks regardless of the block order, and scale the 
+    //! moves per step to their count, empty to use all blocks.
+    void setSourceBlocks(const QVector<int> &bids) {source_blocks = bids;}
+
+    //! Seed the PRNG of the following runs, for reproducible runs.
+    void setSeed(unsigned int seed) {mt.seed(seed);}
+
+    //! Write the annealing state to the file at path after every interval 
+    //! steps of the following runs, an empty path to stop checkpointing.
+    void setCheckpointing(const QString &path, int interval=10);
+
+    //! \brief Continue an anneal from a checkpoint written by a Placer.
+    //!
+    //! The chip must hold the problem of the checkpointed run and the 
+    //! settings must be those of that run, the anneal then makes the same 
+    //! moves as the checkpointed run would have. The initial placement and 
+    //! the coarse levels of multilevel runs are skipped. A time budget goes 
+    //! on from the time the checkpointed run had spent and a kept best 
+    //! placement is restored with it. Returns default results if the 
+    //! checkpoint can't be read or doesn't fit the chip.
+    SAResults resumePlacer(const SASettings &sa_settings, const QString &path);
+
   signals:
     //! Signal for updating GUI with the current chip state.
     void sig_updateGui(sp::Chip *);
 
     //! Signal for updating GUI chart.
-    void sig_updateChart(int cost, float T, float p_accept, int rw_dim);
+    void sig_updateChart(qint64 cost, float T, float p_accept, int rw_dim);
 
   private:
 
+    //! Options of the move loop, read from the settings at runtime.
+    struct RuntimeMoveOpts
+    {
+      bool gui_each_swap; //!< Update the GUI after every move.
+      bool show_stdout;   //!< Print the cost after every move with the GUI updates.
+      bool use_rw;        //!< Pick swap targets from the range window.
+      bool compound;      //!< Compound moves have a nonzero probability.
+      bool directed;      //!< Directed moves have a nonzero ratio.
+      bool sanity_check;  //!< Check the range windows and picked cells.
+      BlockOrder block_order; //!< Order of picking move source blocks.
+    };
+
+    //! Options of the move loop fixed at compile time, so that the branches 
+    //! of disabled features are removed from the instantiated loop and its
+    //! helpers. Runs with GUI updates after every move take the generic loop,
+    //! the updates cost far more than the branches.
+    template<bool UseRW, bool Compound, bool Directed, bool SanityCheck,
+      BlockOrder Order>
+    struct StaticMoveOpts
+    {
+      static const bool gui_each_swap = false;
+      static const bool show_stdout = false;
+      static const bool use_rw = UseRW;
+      static const bool compound = Compound;
+      static const bool directed = Directed;
+      static const bool sanity_check = SanityCheck;
+      static const BlockOrder block_order = Order;
+    };
+
+    //! Move statistics of one temperature step.
+    struct StepStats
+    {
+      long n_swaps=0;         //!< Accepted moves.
+      long n_neutral=0;       //!< Moves that do not change the cost.
+      double cost_accum=0;    //!< Sum of the costs after accepted moves, relative to the cost at the start of the step.
+      double cost_accum_sq=0; //!< Sum of the squares of those relative costs.
+      float p_accept_accum=0; //!< Sum of the acceptance probabilities.
+    };
+
+    //! Move loop instantiated for one combination of StaticMoveOpts.
+    typedef void (Placer::*MoveLoop)(long attempts, int iteration, float T,
+        int rw_dim, qint64 &cost, StepStats &stats);
+
+    //! Return the move loop options of the current settings.
+    RuntimeMoveOpts runtimeMoveOpts() const;
+
+    //! Return the move loop instantiated for the given options, the generic
+    //! loop if they call for GUI updates after every move.
+    static MoveLoop selectMoveLoop(const RuntimeMoveOpts &opts);
+
+    //! Return the move loop instantiated for the leading flags fixed so far
+    //! followed by the remaining ones in flags, and the block order.
+    template<bool... Flags>
+    static typename std::enable_if<(sizeof...(Flags) < 4), MoveLoop>::type
+      selectFlagLoop(const bool *flags, BlockOrder order);
+
+    //! Return the move loop instantiated for the four flags and the block
+    //! order.
+    template<bool... Flags>
+    static typename std::enable_if<sizeof...(Flags) == 4, MoveLoop>::type
+      selectFlagLoop(const bool *flags, BlockOrder order);
+
+    //! Make the given number of move attempts at temperature T, updating the
+    //! cost and the step statistics. Opts is either RuntimeMoveOpts or a 
+    //! StaticMoveOpts instantiation.
+    template<class Opts>
+    void moveLoop(const Opts &opts, long attempts, int iteration, float T,
+        int rw_dim, qint64 &cost, StepStats &stats);
+
+    //! moveLoop with the options of the settings read on every move.
+    void genericMoveLoop(long attempts, int iteration, float T, int rw_dim,
+        qint64 &cost, StepStats &stats);
+
+    //! moveLoop with the options fixed at compile time.
+    template<class Opts>
+    void specializedMoveLoop(long attempts, int iteration, float T, int rw_dim,
+        qint64 &cost, StepStats &stats);
+
+    //! Make the given number of swap attempts in batches of up to batch_size
+    //! swaps that share no cells or nets. The cost deltas of a batch are 
+    //! evaluated together and the swaps are then accepted or rejected in order.
+    void batchMoveLoop(long attempts, float T, int rw_dim, qint64 &cost, 
+        StepStats &stats);
+
+    //! Mark the cells and nets of a picked swap as taken by the current batch.
+    //! Return false without marking if any of them is already taken.
+    bool reserveBatchSwap(const QPair<int,int> &coord_a, 
+        const QPair<int,int> &coord_b, int bid_a, int bid_b);
+
+    //! Start the next temperature step of the run.
+    void beginStep();
+
+    //! Make up to n_moves of the move attempts left in the temperature step,
+    //! return the number made.
+    long makeMoves(long n_moves);
+
+    //! Complete the temperature step: update the schedule and the range 
+    //! window, evaluate the exit conditions and finish or checkpoint.
+    void endStep();
+
+    //! Write the state the next temperature step starts from to the 
+    //! checkpoint file.
+    void writeCheckpoint();
+
+    //! Return the time spent of the time budget, including the time spent
+    //! before the run was resumed.
+    qint64 elapsedMs() const {return run_timer.elapsed() + resumed_ms;}
+
+    //! End the run: run the finishing phase unless stopped early, return to
+    //! the best placement if keeping it, and set the results.
+    void finish();
+
     //! Decide on initial temperature with Sangiovanni-Vincentelli approach.
-    float initTempSV(int rand_moves, float T_fact);
+    //! Moves are sampled within the given range window and only applied to
+    //! the chip if the initial placement is random.
+    float initTempSV(int rand_moves, float T_fact, int rw_dim);
 
     //! Pick random blocks to swap. Directly write to the provided refs.
-    void pickLocsToSwap(QPair<int,int> &coord_a, QPair<int,int> &coord_b,
-        int &bid_a, int &bid_b, int rw_dim);
+    template<class Opts>
+    void pickLocsToSwap(const Opts &opts, QPair<int,int> &coord_a, 
+        QPair<int,int> &coord_b, int &bid_a, int &bid_b, int rw_dim);
 
     //! Pick coord from range window centered around a cell. If the centering 
     //! point causes the range window to go out of bound, then shift the window 
     //! until fitting is possible.
-    void pickCoordFromRangeWindow(const QPair<int,int> &coord_center, 
+    template<class Opts>
+    void pickCoordFromRangeWindow(const Opts &opts, 
+        const QPair<int,int> &coord_center, QPair<int,int> &picked_coord,
+        int rw_dim);
+
+    //! Pick a coord among the occupied cells and the free sites within 
+    //! SPARSE_SITE_RADIUS of them, other than coord_center. Return false if 
+    //! no such coord was drawn within SPARSE_SITE_TRIES tries.
+    bool pickSparseSite(const QPair<int,int> &coord_center, 
+        QPair<int,int> &picked_coord);
+
+    //! Pick coord next to the median location of the blocks connected to the
+    //! specified block, clamped to the range window. Fall back to a random 
+    //! coord in the range window if that coincides with the block's location.
+    template<class Opts>
+    void pickDirectedCoord(const Opts &opts, int bid, 
         QPair<int,int> &picked_coord, int rw_dim);
 
+    //! Pick a compound move, the type is chosen by r in [0, 1) with the 
+    //! p_shift, p_rotate and p_cluster probabilities. The contents of the 
+    //! cells in from are to be moved to the cells in to. Return false if 
+    //! r falls outside of the compound moves or no valid move was found.
+    template<class Opts>
+    bool pickCompoundMove(const Opts &opts, float r, 
+        QVector<QPair<int,int>> &from, QVector<QPair<int,int>> &to, int rw_dim);
+
+    //! Restart the source block sweep, called at the start of every 
+    //! temperature step.
+    void resetSweep();
+
+    //! Return the source block of the next move according to block_order.
+    template<class Opts>
+    int nextSourceBlock(const Opts &opts);
+
     //! Swap the two provided locations.
     void swapLocs(const QPair<int,int> &coord_a, const QPair<int,int> &coord_b);
 
     //! Decide whether to accept a given cost difference. Adds the computed 
     //! acceptance probability to the provided p_accept_accum.
-    bool acceptCostDelta(int delta, float T, float &p_accept_accum);
+    bool acceptCostDelta(qint64 delta, float T, float &p_accept_accum);
 
     //! Update range window size according to the given acceptance probability.
     void updateRangeWindow(int &rw_dim, float p_accept);
 
+    //! Return the modified Lam target acceptance rate at the given fraction 
+    //! of the schedule (Swartz and Sechen, Boyan) with the given plateau.
+    static float lamTargetAccept(float progress, float plateau);
+
     // Private variables
     sp::Chip *chip;         //!< Pointer to the chip.
     SASettings sa_settings; //!< Simulated annealer settings.
@@ -114,7 +427,72 @@ namespace pc{
     std::mt19937 mt;        //!< Use the Mersenne Twister PRNG.
     std::uniform_int_distribution<int> ind_dist;      //!< Random distribution for indices.
     std::uniform_int_distribution<int> bid_dist;      //!< Random distribution for block IDs.
+    std::uniform_int_distribution<int> site_dist;     //!< Random distribution for the blocks sparse sites are drawn around.
+    bool sparse_sites=false;    //!< Whether full chip targets are drawn around the blocks.
     std::uniform_real_distribution<float> prob_dist;  //!< Random distribution for probabilities.
+    float directed_ratio=0;     //!< Current fraction of directed moves.
+    QVector<int> conn_xs;       //!< Scratch space for connected block x coords.
+    QVector<int> conn_ys;       //!< Scratch space for connected block y coords.
+    QVector<int> sweep_order;   //!< Block permutation of the shuffled sweep.
+    int sweep_pos=0;            //!< Position of the sweep in the order or grid.
+    QVector<int> source_blocks; //!< Blocks moves are restricted to, empty for all blocks.
+    QVector<sp::SwapCandidate> batch; //!< Swaps of the current batch.
+    QVector<qint64> batch_deltas;  //!< Cost deltas of the current batch.
+    QVector<int> block_stamps;  //!< Batch marker of the cell of each block.
+    QVector<int> batch_free_cells;  //!< Empty cell indices x+y*nx of the current batch.
+    QVector<int> net_stamps;    //!< Batch marker of each net.
+    int batch_stamp=0;          //!< Marker of the current batch.
+    QString checkpoint_path;    //!< Checkpoint file, empty if not checkpointing.
+    int checkpoint_interval=10; //!< Steps between checkpoints.
+    const AnnealCheckpoint *resume_cp=nullptr;  //!< State the next run continues from, if any.
+
+    // state of the run prepared by init
+    bool done=true;             //!< Whether the run is finished.
+    std::atomic<bool> cancel_requested{false};  //!< Set by cancel.
+    bool cancelled=false;       //!< Whether the run was stopped by cancel.
+    SAResults run_results;      //!< Results of the finished run.
+    QElapsedTimer run_timer;    //!< Wall time spent of the time budget.
+    int ml_iterations=0;        //!< Iterations of the multilevel coarse levels.
+    long ml_moves=0;            //!< Moves of the multilevel coarse levels.
+    long ml_evaluations=0;      //!< Finishing phase evaluations of the multilevel coarse levels.
+    RuntimeMoveOpts runtime_opts; //!< Move loop options of the settings.
+    MoveLoop move_loop=nullptr; //!< Move loop instantiated for the settings.
+    bool batched=false;         //!< Whether swaps are evaluated in batches.
+    long cycle_attempts=1;      //!< Move attempts of a full temperature step.
+    float T=0;                  //!< Temperature of the current or next step.
+    float init_T=0;             //!< Initial temperature.
+    qint64 cost=-1;             //!< Current cost.
+    qint64 init_cost=-1;        //!< Cost of the initial placement.
+    int rw_dim=-1;              //!< Current range window dimension.
+    int iterations=0;           //!< Temperature steps completed.
+    long moves=0;               //!< Moves attempted.
+    long evaluations=0;         //!< Cost evaluations of the finishing phase.
+    int iterations_cost_unchanged=0;  //!< Steps the cost has been unchanged for.
+    bool main_done=false;       //!< Whether the zero temperature steps have begun.
+    int abs_zero_cycles=3;      //!< Zero temperature steps left.
+    float lam_target=1;         //!< Current Lam target acceptance rate.
+    float last_p_accept=-1;     //!< Mean acceptance probability of the last step.
+    bool approx=false;          //!< Whether move deltas are still approximate.
+    float approx_T=0;           //!< Deltas are exact below this T.
+    RejectionFreeSampler *rf_sampler=nullptr; //!< Active in the rejection-free phase.
+    long rf_wait=-1;            //!< Proposals left until the next rejection-free acceptance, -1 if not drawn.
+    bool budgeted=false;        //!< Whether the run has a time budget.
+    bool keep_best=false;       //!< Whether the best placement is kept in the chip journal.
+    bool out_of_time=false;     //!< Whether the time budget ran out.
+    qint64 best_cost=-1;        //!< Lowest cost at the end of a step.
+    float T_final=0;            //!< Final T of a schedule compressed to fit the time budget.
+    qint64 anneal_start_ms=0;   //!< Time the first step started at.
+    qint64 step_ms_cap=0;       //!< Longest step allowed by the time budget.
+    qint64 resumed_ms=0;        //!< Time spent of the budget before the run was resumed.
+
+    // state of the current temperature step
+    bool in_step=false;         //!< Whether a temperature step is under way.
+    long step_attempts=0;       //!< Move attempts of the step.
+    long step_done=0;           //!< Move attempts made so far in the step.
+    StepStats stats;            //!< Move statistics of the step.
+    qint64 step_cost=-1;        //!< Cost at the start of the step.
+    float step_T=0;             //!< T of the step.
+    qint64 step_start_ms=0;     //!< Time the step started at.
   };
 
 }
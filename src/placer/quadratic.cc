@@ -0,0 +1,217 @@
+// @file:     quadratic.cc
+// @author:   Samuel Ng
+// @created:  2021-02-22
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the quadratic initial placer.
+
+#include <algorithm>
+#include <numeric>
+#include <math.h>
+#include "quadratic.h"
+#include "legalizer.h"
+
+// nets with more blocks than this use the star model instead of the clique
+#define MAX_CLIQUE_NET_SIZE 4
+// CG terminates when the residual is reduced by this factor
+#define CG_TOLERANCE 1e-4
+// CG iteration limit per solve
+#define CG_MAX_ITS 200
+
+using namespace pc;
+
+QuadraticPlacer::QuadraticPlacer(sp::Chip *chip)
+  : chip(chip)
+{
+  buildSystem();
+}
+
+qint64 QuadraticPlacer::place(int rounds)
+{
+  int n_blocks = chip->numBlocks();
+  rounds = std::max(rounds, 1);
+
+  // initial anchors and guesses from the current placement, star centers 
+  // start at the chip center
+  QVector<double> anchor_x(n_vars, 0.5 * chip->dimX());
+  QVector<double> anchor_y(n_vars, 0.5 * chip->dimY());
+  for (int bid=0; bid<n_blocks; bid++) {
+    anchor_x[bid] = chip->blockLoc(bid).first;
+    anchor_y[bid] = chip->blockLoc(bid).second;
+  }
+  QVector<double> sol_x = anchor_x;
+  QVector<double> sol_y = anchor_y;
+
+  // rank of each block along an axis mapped uniformly onto the axis length
+  auto spreadByRank = [n_blocks](const QVector<double> &sol, int dim) {
+    QVector<int> order(n_blocks);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sol](int a, int b) {
+          return sol[a] < sol[b];
+        });
+    QVector<double> spread(n_blocks);
+    for (int rank=0; rank<n_blocks; rank++) {
+      spread[order[rank]] = (rank + 0.5) * dim / n_blocks - 0.5;
+    }
+    return spread;
+  };
+
+  QVector<QPair<int,int>> best_locs;
+  qint64 best_cost = -1;
+  double anchor_w = 0.05;
+  for (int round=0; round<rounds; round++) {
+    // vertical wires cost twice as much, weigh the y system accordingly
+    solveCG(sol_x, anchor_x, 1, anchor_w);
+    solveCG(sol_y, anchor_y, 2, anchor_w);
+
+    // spread and legalize
+    QVector<double> spread_x = spreadByRank(sol_x, chip->dimX());
+    QVector<double> spread_y = spreadByRank(sol_y, chip->dimY());
+    QVector<QPointF> targets(n_blocks);
+    for (int bid=0; bid<n_blocks; bid++) {
+      targets[bid] = QPointF(spread_x[bid], spread_y[bid]);
+    }
+    Legalizer::legalize(chip, targets);
+
+    // keep the best legal placement
+    qint64 cost = chip->calcCost();
+    if (best_cost < 0 || cost < best_cost) {
+      best_cost = cost;
+      best_locs.resize(n_blocks);
+      for (int bid=0; bid<n_blocks; bid++) {
+        best_locs[bid] = chip->blockLoc(bid);
+      }
+    }
+
+    // anchor to the legalized placement with a stronger spring next round
+    for (int bid=0; bid<n_blocks; bid++) {
+      anchor_x[bid] = chip->blockLoc(bid).first;
+      anchor_y[bid] = chip->blockLoc(bid).second;
+    }
+    anchor_w *= 2;
+  }
+
+  // restore the best placement
+  chip->initEmptyPlacements();
+  for (int bid=0; bid<n_blocks; bid++) {
+    chip->setLocBlock(best_locs[bid], bid);
+  }
+  return best_cost;
+}
+
+void QuadraticPlacer::buildSystem()
+{
+  sp::Graph *graph = chip->getGraph();
+  int n_blocks = chip->numBlocks();
+
+  // collect weighted edges, star centers are numbered after the blocks
+  struct Edge {int a; int b; double w;};
+  QVector<Edge> edges;
+  n_vars = n_blocks;
+  for (const QList<int> &net : graph->getNets()) {
+    int k = net.size();
+    if (k < 2) {
+      continue;
+    }
+    if (k <= MAX_CLIQUE_NET_SIZE) {
+      double w = 1. / (k - 1);
+      for (int i=0; i<k; i++) {
+        for (int j=i+1; j<k; j++) {
+          edges.append({net[i], net[j], w});
+        }
+      }
+    } else {
+      int star_id = n_vars++;
+      double w = (double)k / (k - 1);
+      for (int bid : net) {
+        edges.append({bid, star_id, w});
+      }
+    }
+  }
+
+  // assemble the symmetric adjacency in CSR form
+  diag.fill(0, n_vars);
+  row_start.fill(0, n_vars+1);
+  for (const Edge &e : edges) {
+    if (e.a == e.b) {
+      continue;
+    }
+    row_start[e.a+1]++;
+    row_start[e.b+1]++;
+    diag[e.a] += e.w;
+    diag[e.b] += e.w;
+  }
+  std::partial_sum(row_start.begin(), row_start.end(), row_start.begin());
+  col_ind.resize(row_start[n_vars]);
+  edge_w.resize(row_start[n_vars]);
+  QVector<int> fill = row_start;
+  for (const Edge &e : edges) {
+    if (e.a == e.b) {
+      continue;
+    }
+    col_ind[fill[e.a]] = e.b;
+    edge_w[fill[e.a]++] = e.w;
+    col_ind[fill[e.b]] = e.a;
+    edge_w[fill[e.b]++] = e.w;
+  }
+}
+
+void QuadraticPlacer::solveCG(QVector<double> &sol, const QVector<double> &anchors,
+    double net_scale, double anchor_w)
+{
+  int n_blocks = chip->numBlocks();
+
+  // right hand side only has anchor terms for blocks
+  QVector<double> rhs(n_vars, 0);
+  for (int bid=0; bid<n_blocks; bid++) {
+    rhs[bid] = anchor_w * anchors[bid];
+  }
+  QVector<double> precond(n_vars);
+  for (int i=0; i<n_vars; i++) {
+    double d = net_scale * diag[i] + (i < n_blocks ? anchor_w : 0);
+    precond[i] = (d > 0) ? 1. / d : 1;
+  }
+  auto dot = [](const QVector<double> &a, const QVector<double> &b) {
+    return std::inner_product(a.begin(), a.end(), b.begin(), 0.);
+  };
+
+  QVector<double> res(n_vars), z(n_vars), dir(n_vars), prod(n_vars);
+  multiply(sol, prod, net_scale, anchor_w);
+  for (int i=0; i<n_vars; i++) {
+    res[i] = rhs[i] - prod[i];
+    z[i] = precond[i] * res[i];
+  }
+  dir = z;
+  double rz = dot(res, z);
+  double stop_norm = CG_TOLERANCE * CG_TOLERANCE * std::max(dot(rhs, rhs), 1e-12);
+  for (int it=0; it<CG_MAX_ITS && dot(res, res) > stop_norm; it++) {
+    multiply(dir, prod, net_scale, anchor_w);
+    double step = rz / dot(dir, prod);
+    for (int i=0; i<n_vars; i++) {
+      sol[i] += step * dir[i];
+      res[i] -= step * prod[i];
+      z[i] = precond[i] * res[i];
+    }
+    double rz_new = dot(res, z);
+    double beta = rz_new / rz;
+    rz = rz_new;
+    for (int i=0; i<n_vars; i++) {
+      dir[i] = z[i] + beta * dir[i];
+    }
+  }
+}
+
+void QuadraticPlacer::multiply(const QVector<double> &vec, QVector<double> &prod,
+    double net_scale, double anchor_w)
+{
+  int n_blocks = chip->numBlocks();
+  for (int i=0; i<n_vars; i++) {
+    // Laplacian row: diag*v_i - sum of w_ij*v_j
+    double off_diag = 0;
+    for (int e=row_start[i]; e<row_start[i+1]; e++) {
+      off_diag += edge_w[e] * vec[col_ind[e]];
+    }
+    prod[i] = net_scale * (diag[i] * vec[i] - off_diag)
+      + (i < n_blocks ? anchor_w * vec[i] : 0);
+  }
+}
@@ -0,0 +1,63 @@
+/*!
+  \file quadratic.h
+  \brief Analytical quadratic wirelength initial placement.
+  \author Samuel Ng
+  \date 2021-02-22 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_QUADRATIC_H_
+#define _PC_QUADRATIC_H_
+
+#include "spatial.h"
+
+namespace pc {
+
+  /*! \brief Quadratic wirelength placement solved by conjugate gradient.
+   *
+   * Nets with few blocks are modelled as cliques with edge weights 1/(k-1) 
+   * while larger nets are modelled as stars with an extra variable for the 
+   * star center, which keeps the system sparse. Since there are no fixed pins
+   * to spread the blocks out, every block is anchored to a position with a 
+   * weak spring: initially the current (random) placement, then the legalized
+   * result of the previous round with a stronger spring. Each round solves
+   * the x and y systems with Jacobi preconditioned CG, spreads the solution by
+   * rank and legalizes it onto the grid. The best legal placement is kept.
+   */
+  class QuadraticPlacer
+  {
+  public:
+    //! Constructor taking the chip to be placed, whose current placement 
+    //! provides the initial anchors.
+    QuadraticPlacer(sp::Chip *chip);
+
+    //! Run the specified number of solve-and-legalize rounds and leave the 
+    //! best legal placement on the chip. Return its cost.
+    qint64 place(int rounds=5);
+
+  private:
+
+    //! Build the sparse system matrix from the netlist.
+    void buildSystem();
+
+    //! Solve (L + anchor_w*I) sol = anchor_w*anchors with preconditioned CG,
+    //! with sol holding the initial guess. Star variables are not anchored.
+    void solveCG(QVector<double> &sol, const QVector<double> &anchors,
+        double net_scale, double anchor_w);
+
+    //! Compute prod = (net_scale*L + anchor_w*I) * vec.
+    void multiply(const QVector<double> &vec, QVector<double> &prod,
+        double net_scale, double anchor_w);
+
+    // Private variables
+    sp::Chip *chip;             //!< The chip to be placed.
+    int n_vars=0;               //!< Number of variables (blocks then star centers).
+    QVector<int> row_start;     //!< CSR row offsets of the off-diagonal entries.
+    QVector<int> col_ind;       //!< CSR column indices of the off-diagonal entries.
+    QVector<double> edge_w;     //!< CSR values (positive edge weights) of the off-diagonal entries.
+    QVector<double> diag;       //!< Sum of incident edge weights of each variable.
+  };
+
+}
+
+#endif
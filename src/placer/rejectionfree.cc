@@ -0,0 +1,342 @@
+// @file:     rejectionfree.cc
+// @author:   Samuel Ng
+// @created:  2021-02-26
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the rejection-free move sampler.
+
+#include <algorithm>
+#include <math.h>
+#include "rejectionfree.h"
+
+// nets larger than this do not trigger re-evaluation of their blocks' 
+// candidates, which are marked stale instead
+#define MAX_UPDATE_NET_SIZE 32
+
+// weight of stale candidates, an upper bound of every acceptance probability
+#define STALE_WEIGHT 1.0
+
+using namespace pc;
+
+RejectionFreeSampler::RejectionFreeSampler(sp::Chip *chip, int rw_dim)
+  : chip(chip), rw_dim(rw_dim)
+{
+  allocate();
+  evaluateAll();
+}
+
+RejectionFreeSampler::RejectionFreeSampler(sp::Chip *chip, int rw_dim,
+    const QVector<qint64> &t_deltas, const QVector<bool> &t_stale,
+    const QVector<bool> &t_blk_stale)
+  : chip(chip), rw_dim(rw_dim)
+{
+  allocate();
+  if (t_deltas.size() == deltas.size() && t_stale.size() == stale.size()
+      && t_blk_stale.size() == blk_stale.size()) {
+    deltas = t_deltas;
+    stale = t_stale;
+    blk_stale = t_blk_stale;
+  } else {
+    evaluateAll();
+  }
+}
+
+void RejectionFreeSampler::setTemperature(float t_T)
+{
+  T = t_T;
+  total_weight = 0;
+  uphill_weight = 0;
+  // linear time Fenwick tree construction
+  for (int cand=0; cand<weights.size(); cand++) {
+    weights[cand] = stale[cand] ? STALE_WEIGHT : acceptProb(deltas[cand]);
+    tree[cand+1] = weights[cand];
+    total_weight += weights[cand];
+    if (!stale[cand] && deltas[cand] > 0) {
+      uphill_weight += weights[cand];
+    }
+  }
+  for (int i=1; i<tree.size(); i++) {
+    int parent = i + (i & -i);
+    if (parent < tree.size()) {
+      tree[parent] += tree[i];
+    }
+  }
+}
+
+long RejectionFreeSampler::drawWait(std::mt19937 &mt)
+{
+  double p_accept = total_weight / weights.size();
+  if (p_accept <= 1e-12) {
+    return -1;
+  } else if (p_accept >= 1) {
+    return 1;
+  }
+  std::uniform_real_distribution<double> dist(0, 1);
+  double u = 1 - dist(mt);  // in (0, 1]
+  return 1 + (long)std::floor(log(u) / log1p(-p_accept));
+}
+
+int RejectionFreeSampler::drawCandidate(std::mt19937 &mt)
+{
+  std::uniform_real_distribution<double> dist(0, total_weight);
+  double target = dist(mt);
+  // descend the Fenwick tree to the first candidate whose prefix sum exceeds
+  // the target
+  int pos = 0;
+  int step = 1;
+  while (step * 2 < tree.size()) {
+    step *= 2;
+  }
+  for (; step > 0; step /= 2) {
+    if (pos + step < tree.size() && tree[pos + step] <= target) {
+      pos += step;
+      target -= tree[pos];
+    }
+  }
+  // guard against rounding landing on a zero weight candidate
+  int cand = std::min(pos, weights.size() - 1);
+  while (cand > 0 && weights[cand] == 0) {
+    cand--;
+  }
+  return cand;
+}
+
+bool RejectionFreeSampler::applyCandidate(int cand, std::mt19937 &mt, qint64 &cost_delta)
+{
+  // the cached weight is an upper bound of the fresh one, thinning by their
+  // ratio draws the move in proportion to its fresh acceptance probability
+  double cached_weight = weights[cand];
+  updateCandidate(cand);
+  if (weights[cand] < cached_weight) {
+    std::uniform_real_distribution<double> dist(0, 1);
+    if (dist(mt) * cached_weight >= weights[cand]) {
+      return false;
+    }
+  }
+
+  int bid_a = cand / n_per_block;
+  QPair<int,int> coord_a = chip->blockLoc(bid_a);
+  QPair<int,int> coord_b = candidateCell(cand);
+  int bid_b = chip->blockIdAt(coord_b);
+  cost_delta = deltas[cand];
+  chip->setLocBlock(coord_a, bid_b);
+  chip->setLocBlock(coord_b, bid_a);
+
+  // blocks whose candidates all changed: the moved blocks and the blocks 
+  // sharing small nets with them
+  stamp++;
+  QVector<int> affected;
+  auto addAffected = [this, &affected](int bid) {
+    if (bid != -1 && blk_stamp[bid] != stamp) {
+      blk_stamp[bid] = stamp;
+      affected.append(bid);
+    }
+  };
+  sp::Graph *graph = chip->getGraph();
+  addAffected(bid_a);
+  addAffected(bid_b);
+  for (int bid : {bid_a, bid_b}) {
+    if (bid == -1) {
+      continue;
+    }
+    for (int net_id : graph->blockNets(bid)) {
+      const QList<int> &net = graph->getNet(net_id);
+      if (net.size() <= MAX_UPDATE_NET_SIZE) {
+        for (int n_bid : net) {
+          addAffected(n_bid);
+        }
+      }
+    }
+  }
+  for (int bid : affected) {
+    updateBlock(bid);
+  }
+
+  // candidates of other blocks that target the cells of affected blocks or
+  // the two swapped cells
+  QList<QPair<int,int>> cells;
+  cells << coord_a << coord_b;
+  for (int bid : affected) {
+    if (bid != bid_a && bid != bid_b) {
+      cells << chip->blockLoc(bid);
+    }
+  }
+  for (const QPair<int,int> &cell : cells) {
+    touchTargeting(cell, false);
+  }
+
+  // re-evaluating the candidates of all blocks on large nets after every 
+  // move would dominate the run time, they are marked stale and only 
+  // re-evaluated when drawn
+  for (int bid : {bid_a, bid_b}) {
+    if (bid == -1) {
+      continue;
+    }
+    for (int net_id : graph->blockNets(bid)) {
+      const QList<int> &net = graph->getNet(net_id);
+      if (net.size() > MAX_UPDATE_NET_SIZE) {
+        for (int n_bid : net) {
+          if (blk_stamp[n_bid] != stamp) {
+            markBlockStale(n_bid);
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+float RejectionFreeSampler::uphillAcceptPerProposal() const
+{
+  return uphill_weight / weights.size();
+}
+
+void RejectionFreeSampler::allocate()
+{
+  n_per_block = std::min(rw_dim, chip->dimX()) * std::min(rw_dim, chip->dimY()) - 1;
+  int n_cands = chip->numBlocks() * n_per_block;
+  deltas.fill(0, n_cands);
+  stale.fill(false, n_cands);
+  weights.fill(0, n_cands);
+  tree.fill(0, n_cands + 1);
+  blk_stamp.fill(0, chip->numBlocks());
+  blk_stale.fill(false, chip->numBlocks());
+}
+
+void RejectionFreeSampler::evaluateAll()
+{
+  for (int cand=0; cand<deltas.size(); cand++) {
+    QPair<int,int> loc = chip->blockLoc(cand / n_per_block);
+    QPair<int,int> cell = candidateCell(cand);
+    deltas[cand] = chip->calcSwapCostDelta(loc.first, loc.second, cell.first, cell.second);
+    n_evals++;
+  }
+}
+
+double RejectionFreeSampler::acceptProb(qint64 delta) const
+{
+  if (delta == 0) {
+    // cost neutral moves are left out, see the class description
+    return 0;
+  } else if (delta < 0) {
+    return 1;
+  } else if (T <= 0) {
+    return 0;
+  }
+  return std::exp(- (double)delta / T);
+}
+
+void RejectionFreeSampler::updateCandidate(int cand)
+{
+  QPair<int,int> loc = chip->blockLoc(cand / n_per_block);
+  QPair<int,int> cell = candidateCell(cand);
+  qint64 delta = chip->calcSwapCostDelta(loc.first, loc.second, cell.first, cell.second);
+  n_evals++;
+  if (stale[cand]) {
+  } else if (deltas[cand] > 0) {
+    uphill_weight -= weights[cand];
+  }
+  deltas[cand] = delta;
+  setWeight(cand, acceptProb(delta));
+  if (delta > 0) {
+    uphill_weight += weights[cand];
+  }
+
+  // the blocks involved no longer have all of their candidates stale
+  blk_stale[cand / n_per_block] = false;
+  int target_bid = chip->blockIdAt(cell);
+  if (target_bid != -1) {
+    blk_stale[target_bid] = false;
+  }
+}
+
+void RejectionFreeSampler::markStale(int cand)
+{
+  if (stale[cand]) {
+    return;
+  }
+  if (deltas[cand] > 0) {
+    uphill_weight -= weights[cand];
+  }
+  stale[cand] = true;
+  setWeight(cand, STALE_WEIGHT);
+}
+
+void RejectionFreeSampler::markBlockStale(int bid)
+{
+  if (blk_stale[bid]) {
+    return;
+  }
+  blk_stale[bid] = true;
+  for (int cand=bid*n_per_block; cand<(bid+1)*n_per_block; cand++) {
+    markStale(cand);
+  }
+  touchTargeting(chip->blockLoc(bid), true);
+}
+
+void RejectionFreeSampler::touchTargeting(const QPair<int,int> &cell, bool mark_stale)
+{
+  int x_lo = std::max(cell.first - rw_dim + 1, 0);
+  int x_hi = std::min(cell.first + rw_dim - 1, chip->dimX() - 1);
+  int y_lo = std::max(cell.second - rw_dim + 1, 0);
+  int y_hi = std::min(cell.second + rw_dim - 1, chip->dimY() - 1);
+  for (int x=x_lo; x<=x_hi; x++) {
+    for (int y=y_lo; y<=y_hi; y++) {
+      int bid = chip->blockIdAt(x, y);
+      if (bid == -1 || blk_stamp[bid] == stamp) {
+        continue;
+      }
+      int other = cellCandidate(bid, cell);
+      if (other == -1) {
+        continue;
+      }
+      if (mark_stale) {
+        markStale(other);
+      } else {
+        updateCandidate(other);
+      }
+    }
+  }
+}
+
+void RejectionFreeSampler::updateBlock(int bid)
+{
+  for (int cand=bid*n_per_block; cand<(bid+1)*n_per_block; cand++) {
+    updateCandidate(cand);
+  }
+}
+
+QPair<int,int> RejectionFreeSampler::candidateCell(int cand)
+{
+  QPair<int,int> loc = chip->blockLoc(cand / n_per_block);
+  QRect win = chip->rangeWindow(loc, rw_dim);
+  // window cells in row-major order, skipping the block's own cell
+  int own = (loc.second - win.top()) * win.width() + (loc.first - win.left());
+  int ind = cand % n_per_block;
+  if (ind >= own) {
+    ind++;
+  }
+  return qMakePair(win.left() + ind % win.width(), win.top() + ind / win.width());
+}
+
+int RejectionFreeSampler::cellCandidate(int bid, const QPair<int,int> &cell)
+{
+  QPair<int,int> loc = chip->blockLoc(bid);
+  QRect win = chip->rangeWindow(loc, rw_dim);
+  if (!win.contains(cell.first, cell.second) || cell == loc) {
+    return -1;
+  }
+  int own = (loc.second - win.top()) * win.width() + (loc.first - win.left());
+  int ind = (cell.second - win.top()) * win.width() + (cell.first - win.left());
+  return bid * n_per_block + ((ind > own) ? ind - 1 : ind);
+}
+
+void RejectionFreeSampler::setWeight(int cand, double weight)
+{
+  double diff = weight - weights[cand];
+  weights[cand] = weight;
+  total_weight += diff;
+  for (int i=cand+1; i<tree.size(); i += (i & -i)) {
+    tree[i] += diff;
+  }
+}
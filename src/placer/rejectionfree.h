@@ -0,0 +1,143 @@
+/*!
+  \file rejectionfree.h
+  \brief Rejection-free (N-fold way) move sampling for low temperatures.
+  \author Samuel Ng
+  \date 2021-02-26 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_REJECTIONFREE_H_
+#define _PC_REJECTIONFREE_H_
+
+#include <random>
+#include "spatial.h"
+
+namespace pc {
+
+  /*! \brief Sample accepted moves directly instead of proposing and rejecting.
+   *
+   * The candidate moves are the swaps of every block with every other cell of
+   * its range window, which is exactly the proposal set of the annealer at a
+   * fixed range window. The cost delta of each candidate is cached and its 
+   * acceptance probability is kept in a Fenwick tree, so that an accepted 
+   * move can be drawn in proportion to its probability. The number of 
+   * proposals a conventional annealer would have made until that acceptance
+   * follows a geometric distribution and is drawn separately. After a move,
+   * the candidates involving moved blocks, the blocks sharing nets of up to
+   * MAX_UPDATE_NET_SIZE pins with them, or the cells they occupy are 
+   * re-evaluated. Candidates involving blocks that only share larger nets 
+   * with the moved blocks are marked stale instead and weighted by an upper
+   * bound of any acceptance probability. A drawn stale candidate is 
+   * re-evaluated and applied with the ratio of its fresh to its bounding 
+   * weight, so that moves are still drawn in proportion to their fresh
+   * acceptance probabilities, only more proposals are spent on stale ones.
+   *
+   * Cost neutral candidates are given zero weight. They are accepted at any 
+   * temperature and would otherwise make up most of the sampled moves, each 
+   * one paying for the candidate updates without changing the cost.
+   */
+  class RejectionFreeSampler
+  {
+  public:
+    //! Constructor taking the chip and the (fixed) range window dimension.
+    //! Evaluates all candidate moves.
+    RejectionFreeSampler(sp::Chip *chip, int rw_dim);
+
+    //! Constructor restoring the cached deltas and stale flags of a sampler
+    //! on the same chip placement, as returned by cachedDeltas, staleFlags 
+    //! and staleBlocks. Evaluates all candidate moves instead if their sizes
+    //! do not match the chip.
+    RejectionFreeSampler(sp::Chip *chip, int rw_dim, const QVector<qint64> &deltas,
+        const QVector<bool> &stale, const QVector<bool> &blk_stale);
+
+    //! Set the temperature and recompute all acceptance probabilities.
+    void setTemperature(float T);
+
+    //! Draw the number of proposals until the next acceptance, including the
+    //! accepted one. Returns -1 if no candidate can ever be accepted.
+    long drawWait(std::mt19937 &mt);
+
+    //! Draw a candidate in proportion to the cached acceptance probabilities.
+    int drawCandidate(std::mt19937 &mt);
+
+    //! Re-evaluate the candidate and apply it to the chip with the ratio of
+    //! the fresh to the cached weight, which is below 1 if the candidate was
+    //! stale. Return whether the move was applied, the cost delta is written
+    //! to the provided ref.
+    bool applyCandidate(int cand, std::mt19937 &mt, qint64 &cost_delta);
+
+    //! Return the sum of acceptance probabilities of uphill candidates divided
+    //! by the number of candidates, i.e. the expected acceptance probability
+    //! of a proposed uphill move per proposal. Stale candidates are left out.
+    float uphillAcceptPerProposal() const;
+
+    //! Return the number of swap cost deltas evaluated so far.
+    long evaluations() const {return n_evals;}
+
+    //! Return the cached cost delta of each candidate.
+    const QVector<qint64> &cachedDeltas() const {return deltas;}
+
+    //! Return whether the cached delta of each candidate may be out of date.
+    const QVector<bool> &staleFlags() const {return stale;}
+
+    //! Return whether all candidates involving each block are stale.
+    const QVector<bool> &staleBlocks() const {return blk_stale;}
+
+  private:
+
+    //! Size the candidate and block vectors for the chip and range window.
+    void allocate();
+
+    //! Evaluate the cost deltas of all candidates afresh.
+    void evaluateAll();
+
+    //! Return the acceptance probability of the cost delta at the current T.
+    double acceptProb(qint64 delta) const;
+
+    //! Re-evaluate the candidate with the specified index.
+    void updateCandidate(int cand);
+
+    //! Re-evaluate all candidates of the specified block.
+    void updateBlock(int bid);
+
+    //! Give the candidate the stale weight until it is re-evaluated.
+    void markStale(int cand);
+
+    //! Mark the candidates of the block and the candidates of other blocks
+    //! targeting its cell stale.
+    void markBlockStale(int bid);
+
+    //! Re-evaluate, or mark stale, the candidates of blocks not collected 
+    //! for the current move that target the cell.
+    void touchTargeting(const QPair<int,int> &cell, bool mark_stale);
+
+    //! Return the cell targeted by the candidate.
+    QPair<int,int> candidateCell(int cand);
+
+    //! Return the candidate of the block targeting the cell, -1 if the cell
+    //! is not in the block's range window.
+    int cellCandidate(int bid, const QPair<int,int> &cell);
+
+    //! Set the weight of a candidate in the Fenwick tree.
+    void setWeight(int cand, double weight);
+
+    // Private variables
+    sp::Chip *chip;             //!< The chip being annealed.
+    int rw_dim;                 //!< Range window dimension.
+    int n_per_block;            //!< Candidates per block (window cells less one).
+    float T=0;                  //!< Current temperature.
+    long n_evals=0;             //!< Number of cost deltas evaluated.
+    QVector<qint64> deltas;     //!< Cached cost delta of each candidate.
+    QVector<bool> stale;        //!< Whether the cached delta may be out of date.
+    QVector<double> weights;    //!< Acceptance probability of each candidate.
+    QVector<double> tree;       //!< Fenwick tree over the weights.
+    double total_weight=0;      //!< Sum of all weights.
+    double uphill_weight=0;     //!< Sum of the weights of uphill candidates.
+    QVector<int> blk_stamp;     //!< Per-block marker for collecting affected blocks.
+    int stamp=0;                //!< Current marker value.
+    QVector<bool> blk_stale;    //!< Whether all candidates involving the block are stale.
+  };
+
+}
+
+#endif
@@ -0,0 +1,336 @@
+// @file:     smallplacer.cc
+// @author:   Samuel Ng
+// @created:  2021-02-28
+// @license:  GNU LGPL v3
+//
+// @desc:     Implementation of the fixed-size small chip placer.
+
+#include <algorithm>
+#include <math.h>
+#include "smallplacer.h"
+
+using namespace pc;
+
+bool SmallPlacer::supports(sp::Chip *chip, const SASettings &sa_settings)
+{
+  if (!chip->isInitialized() || chip->numBlocks() < 2
+      || chip->dimX() * chip->dimY() > MAX_CELLS || chip->numNets() > MAX_NETS
+      || chip->costModel() != sp::CostModel::HPWL) {
+    return false;
+  }
+  int n_pins = 0;
+  for (const QList<int> &net : chip->getGraph()->getNets()) {
+    n_pins += net.size();
+  }
+  if (n_pins > MAX_PINS) {
+    return false;
+  }
+  return (sa_settings.init_place == InitPlace::RandomInit
+      || sa_settings.init_place == InitPlace::ExistingInit)
+    && sa_settings.t_schd != TSchd::LamTUpdate
+    && sa_settings.finish_mode == FinishMode::RandomFinish
+    && sa_settings.block_order == BlockOrder::RandomOrder
+    && sa_settings.batch_size <= 1 && sa_settings.approx_net_size == 0
+    && sa_settings.time_budget_ms == 0 && !sa_settings.keep_best
+    && sa_settings.directed_ratio == 0 && sa_settings.p_shift == 0
+    && sa_settings.p_rotate == 0 && sa_settings.p_cluster == 0
+    && !sa_settings.rejection_free && !sa_settings.multilevel
+    && !sa_settings.skip_anneal && !sa_settings.sanity_check;
+}
+
+SmallPlacer::SmallPlacer(sp::Chip *chip)
+  : chip(chip), mt(std::random_device()())
+{
+  nx = chip->dimX();
+  ny = chip->dimY();
+  n_cells = nx * ny;
+  n_blocks = chip->numBlocks();
+  n_nets = chip->numNets();
+  sp::Graph *graph = chip->getGraph();
+  int pin = 0;
+  for (int net_id=0; net_id<n_nets; net_id++) {
+    net_start[net_id] = pin;
+    for (int bid : graph->getNet(net_id)) {
+      net_pins[pin++] = bid;
+    }
+    net_weight[net_id] = graph->netWeight(net_id);
+    net_stamp[net_id] = 0;
+  }
+  net_start[n_nets] = pin;
+  pin = 0;
+  for (int bid=0; bid<n_blocks; bid++) {
+    block_start[bid] = pin;
+    for (int net_id : graph->blockNets(bid)) {
+      block_nets[pin++] = net_id;
+    }
+  }
+  block_start[n_blocks] = pin;
+}
+
+SAResults SmallPlacer::runPlacer(const SASettings &t_sa_settings)
+{
+  sa_settings = t_sa_settings;
+  if (sa_settings.init_place == InitPlace::RandomInit) {
+    initBlockPos();
+  } else {
+    std::fill(grid, grid + n_cells, -1);
+    for (int bid=0; bid<n_blocks; bid++) {
+      QPair<int,int> loc = chip->blockLoc(bid);
+      block_x[bid] = loc.first;
+      block_y[bid] = loc.second;
+      grid[loc.first + loc.second * nx] = bid;
+    }
+  }
+  calcCost();
+
+  sa_settings.min_rw_dim = std::min(sa_settings.min_rw_dim, std::min(nx, ny));
+  bool exit_cond = false;
+  bool main_done = false;
+  int abs_zero_cycles = 3;
+  int cycle_attempts = sa_settings.swap_fact * pow(n_blocks, (4./3));
+  cycle_attempts = std::max(cycle_attempts, 1);
+  int iterations = 0;
+  long moves = 0;
+  int iterations_cost_unchanged = 0;
+  int cell_a, cell_b;
+
+  int rw_dim = std::max(nx, ny);
+  if (sa_settings.init_rw_dim > 0) {
+    rw_dim = std::max(std::min(sa_settings.init_rw_dim, rw_dim), sa_settings.min_rw_dim);
+  }
+
+  // initial temperature from the spread of random swap costs, random initial
+  // placements are randomized further by applying them
+  long delta_accum = 0;
+  long delta_accum_sq = 0;
+  const int rand_moves = 50;
+  for (int i=0; i<rand_moves; i++) {
+    pickSwap(rw_dim, cell_a, cell_b);
+    int cost_delta = swapDelta(cell_a, cell_b);
+    if (sa_settings.init_place == InitPlace::RandomInit) {
+      applySwap(cell_a, cell_b);
+    }
+    delta_accum += cost_delta;
+    delta_accum_sq += pow(cost_delta, 2);
+  }
+  float T = sa_settings.init_t_fact
+    * sqrt(delta_accum_sq/rand_moves - pow(delta_accum/rand_moves, 2));
+  int cost = calcCost();
+  int init_cost = cost;
+
+  while (!exit_cond) {
+    int attempts = cycle_attempts;
+    int n_swaps = 0;
+    long cost_accum = 0;
+    long cost_accum_sq = 0;
+    float p_accept_accum = 0;
+    int cost_i = cost;
+    if (main_done) {
+      T = 0;
+    }
+    while (attempts--) {
+      pickSwap(rw_dim, cell_a, cell_b);
+      int cost_delta = swapDelta(cell_a, cell_b);
+      if (acceptCostDelta(cost_delta, T, p_accept_accum)) {
+        applySwap(cell_a, cell_b);
+        cost += cost_delta;
+        n_swaps++;
+        cost_accum += cost;
+        cost_accum_sq += pow(cost, 2);
+      }
+    }
+    moves += cycle_attempts;
+
+    iterations++;
+    if (sa_settings.use_rw) {
+      updateRangeWindow(rw_dim, p_accept_accum/cycle_attempts);
+    }
+    if (sa_settings.t_schd == TSchd::StdDevTUpdate) {
+      double std_dev = (n_swaps > 0)
+        ? sqrt(cost_accum_sq/n_swaps - pow(cost_accum/n_swaps, 2)) : 0;
+      T = T * exp(-0.7 * T / std_dev);
+    } else {
+      T *= sa_settings.decay_b;
+    }
+
+    if (sa_settings.show_stdout) {
+      qDebug() << QString("Curr stored cost=%1, Next T=%2, iterations=%3, avg P "
+          "accept=%4, range window dim=%5").arg(cost).arg(T).arg(iterations)
+        .arg(p_accept_accum/cycle_attempts).arg(rw_dim);
+    }
+
+    iterations_cost_unchanged = (cost_i==cost) ? iterations_cost_unchanged+1 : 0;
+    if (main_done) {
+      abs_zero_cycles--;
+      exit_cond = (abs_zero_cycles < 0);
+    } else {
+      main_done = iterations == sa_settings.max_its - 1 || isnan(T)
+        || iterations_cost_unchanged > sa_settings.max_its_cost_unchanged;
+    }
+  }
+
+  // write the final placement back to the chip
+  chip->initEmptyPlacements();
+  for (int bid=0; bid<n_blocks; bid++) {
+    chip->setLocBlock(qMakePair(block_x[bid], block_y[bid]), bid);
+  }
+  chip->setCost(cost);
+
+  SAResults results;
+  results.cost = cost;
+  results.iterations = iterations;
+  results.moves = moves;
+  results.init_cost = init_cost;
+  return results;
+}
+
+void SmallPlacer::initBlockPos()
+{
+  int cells[MAX_CELLS];
+  for (int cell=0; cell<n_cells; cell++) {
+    cells[cell] = cell;
+    grid[cell] = -1;
+  }
+  // partial Fisher-Yates shuffle, the first n_blocks cells get occupied
+  for (int bid=0; bid<n_blocks; bid++) {
+    std::uniform_int_distribution<int> dist(bid, n_cells-1);
+    std::swap(cells[bid], cells[dist(mt)]);
+    grid[cells[bid]] = bid;
+    block_x[bid] = cells[bid] % nx;
+    block_y[bid] = cells[bid] / nx;
+  }
+}
+
+void SmallPlacer::pickSwap(int rw_dim, int &cell_a, int &cell_b)
+{
+  std::uniform_int_distribution<int> bid_dist(0, n_blocks-1);
+  int bid_a = bid_dist(mt);
+  int x = block_x[bid_a];
+  int y = block_y[bid_a];
+  cell_a = x + y * nx;
+  if (!sa_settings.use_rw || rw_dim == std::max(nx, ny)) {
+    // pick anywhere but the source cell
+    std::uniform_int_distribution<int> cell_dist(0, n_cells-2);
+    cell_b = cell_dist(mt);
+    cell_b += (cell_b >= cell_a);
+    return;
+  }
+  // range window centered at the block, shifted to fit into the chip
+  int w = std::min(rw_dim, nx);
+  int h = std::min(rw_dim, ny);
+  int left = std::max(std::min(x - rw_dim/2, nx - w), 0);
+  int top = std::max(std::min(y - rw_dim/2, ny - h), 0);
+  std::uniform_int_distribution<int> rw_dist(0, w*h-1);
+  do {
+    int rw_ind = rw_dist(mt);
+    cell_b = (left + rw_ind % w) + (top + rw_ind / w) * nx;
+  } while (cell_b == cell_a);
+}
+
+int SmallPlacer::swapDelta(int cell_a, int cell_b)
+{
+  int bid_a = grid[cell_a];
+  int bid_b = grid[cell_b];
+  // collect the nets of both blocks
+  stamp++;
+  n_touched = 0;
+  for (int bid : {bid_a, bid_b}) {
+    if (bid < 0) {
+      continue;
+    }
+    for (int i=block_start[bid]; i<block_start[bid+1]; i++) {
+      int net_id = block_nets[i];
+      if (net_stamp[net_id] != stamp) {
+        net_stamp[net_id] = stamp;
+        touched[n_touched++] = net_id;
+      }
+    }
+  }
+  // evaluate the nets with the blocks tentatively swapped
+  int x_a = cell_a % nx, y_a = cell_a / nx;
+  int x_b = cell_b % nx, y_b = cell_b / nx;
+  block_x[bid_a] = x_b;
+  block_y[bid_a] = y_b;
+  if (bid_b >= 0) {
+    block_x[bid_b] = x_a;
+    block_y[bid_b] = y_a;
+  }
+  int delta = 0;
+  for (int i=0; i<n_touched; i++) {
+    int net_id = touched[i];
+    net_new_cost[net_id] = netCost(net_id);
+    delta += net_new_cost[net_id] - net_cost[net_id];
+  }
+  block_x[bid_a] = x_a;
+  block_y[bid_a] = y_a;
+  if (bid_b >= 0) {
+    block_x[bid_b] = x_b;
+    block_y[bid_b] = y_b;
+  }
+  return delta;
+}
+
+void SmallPlacer::applySwap(int cell_a, int cell_b)
+{
+  int bid_a = grid[cell_a];
+  int bid_b = grid[cell_b];
+  grid[cell_a] = bid_b;
+  grid[cell_b] = bid_a;
+  block_x[bid_a] = cell_b % nx;
+  block_y[bid_a] = cell_b / nx;
+  if (bid_b >= 0) {
+    block_x[bid_b] = cell_a % nx;
+    block_y[bid_b] = cell_a / nx;
+  }
+  for (int i=0; i<n_touched; i++) {
+    net_cost[touched[i]] = net_new_cost[touched[i]];
+  }
+}
+
+int SmallPlacer::netCost(int net_id) const
+{
+  sp::BBoxAcc acc;
+  for (int i=net_start[net_id]; i<net_start[net_id+1]; i++) {
+    acc.add(block_x[net_pins[i]], block_y[net_pins[i]]);
+  }
+  return net_weight[net_id] * sp::HPWLModel::cost(acc, 0);
+}
+
+int SmallPlacer::calcCost()
+{
+  int cost = 0;
+  for (int net_id=0; net_id<n_nets; net_id++) {
+    net_cost[net_id] = netCost(net_id);
+    cost += net_cost[net_id];
+  }
+  return cost;
+}
+
+bool SmallPlacer::acceptCostDelta(int delta, float T, float &p_accept_accum)
+{
+  if (delta <= 0) {
+    return true;
+  }
+  float prob = std::exp(- (float)delta / T);
+  p_accept_accum += prob;
+  return std::uniform_real_distribution<float>(0.0, 1.0)(mt) < prob;
+}
+
+void SmallPlacer::updateRangeWindow(int &rw_dim, float p_accept) const
+{
+  int max_dim = std::max(nx, ny);
+  if (p_accept > sa_settings.p_upper) {
+    if (rw_dim == max_dim) {
+      return;
+    }
+    rw_dim = std::min(rw_dim + sa_settings.rw_dim_delta, max_dim);
+  } else if (p_accept < sa_settings.p_lower) {
+    if (rw_dim == sa_settings.min_rw_dim) {
+      return;
+    }
+    rw_dim = std::max(rw_dim - sa_settings.rw_dim_delta, sa_settings.min_rw_dim);
+  }
+  if (rw_dim % 2 != 1) {
+    rw_dim -= 1;
+  }
+}
@@ -0,0 +1,100 @@
+/*!
+  \file smallplacer.h
+  \brief Fixed-size annealing engine for small chips.
+  \author Samuel Ng
+  \date 2021-02-28 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PC_SMALLPLACER_H_
+#define _PC_SMALLPLACER_H_
+
+#include <random>
+#include "placer.h"
+
+namespace pc {
+
+  /*! \brief Simulated annealing of chips within compile-time size bounds.
+   *
+   * Runs the same anneal as Placer for the default move set, but keeps the
+   * grid, the block locations, the netlist (as pin index ranges) and the
+   * per-net costs in fixed-size arrays that are copied from the chip once.
+   * No containers are allocated and no signals are emitted during the anneal,
+   * the final placement and cost are written back to the chip. Meant for the
+   * many tiny problems where the per-run overhead of Placer dominates.
+   */
+  class SmallPlacer
+  {
+  public:
+    static const int MAX_CELLS = 64;  //!< Largest supported chip area.
+    static const int MAX_NETS = 64;   //!< Largest supported net count.
+    static const int MAX_PINS = 256;  //!< Largest supported total pin count.
+
+    //! Return whether the chip fits within the bounds and the settings only
+    //! use features supported by this engine: random or existing initial
+    //! placement, exponential decay or dynamic schedule, random source
+    //! blocks, unbatched swap moves only, exact deltas, no time budget or
+    //! best-so-far tracking, random finishing cycles and the HPWL cost.
+    static bool supports(sp::Chip *chip, const SASettings &sa_settings);
+
+    //! Constructor taking a chip for which supports() holds.
+    SmallPlacer(sp::Chip *chip);
+
+    //! Run the anneal and write the final placement back to the chip.
+    SAResults runPlacer(const SASettings &sa_settings);
+
+  private:
+
+    //! Place the blocks onto random distinct cells.
+    void initBlockPos();
+
+    //! Pick a random block and a distinct target cell in its range window.
+    void pickSwap(int rw_dim, int &cell_a, int &cell_b);
+
+    //! Return the cost change of swapping the contents of two cells, the new
+    //! costs of the affected nets are kept for applySwap.
+    int swapDelta(int cell_a, int cell_b);
+
+    //! Apply the swap last evaluated by swapDelta.
+    void applySwap(int cell_a, int cell_b);
+
+    //! Return the weighted HPWL of a net at the current block locations.
+    int netCost(int net_id) const;
+
+    //! Return the sum of all net costs, refreshing the stored net costs.
+    int calcCost();
+
+    //! Return whether to accept a cost change at temperature T, adding the
+    //! acceptance probability of uphill moves to p_accept_accum.
+    bool acceptCostDelta(int delta, float T, float &p_accept_accum);
+
+    //! Update the range window size for the given acceptance probability.
+    void updateRangeWindow(int &rw_dim, float p_accept) const;
+
+    // Private variables
+    sp::Chip *chip;                 //!< The chip, only read and written at the ends.
+    SASettings sa_settings;         //!< Simulated annealer settings.
+    std::mt19937 mt;                //!< Mersenne Twister PRNG.
+    int nx, ny;                     //!< Chip dimensions.
+    int n_cells;                    //!< Number of cells.
+    int n_blocks;                   //!< Number of blocks.
+    int n_nets;                     //!< Number of nets.
+    int grid[MAX_CELLS];            //!< Block ID at each cell index x+y*nx, -1 if empty.
+    int block_x[MAX_CELLS];         //!< x of each block.
+    int block_y[MAX_CELLS];         //!< y of each block.
+    int net_start[MAX_NETS+1];      //!< Range of each net in net_pins.
+    int net_pins[MAX_PINS];         //!< Block IDs of the pins of all nets.
+    int block_start[MAX_CELLS+1];   //!< Range of each block in block_nets.
+    int block_nets[MAX_PINS];       //!< Net IDs of the pins of all blocks.
+    int net_weight[MAX_NETS];       //!< Cost multiplier of each net.
+    int net_cost[MAX_NETS];         //!< Current cost of each net.
+    int net_new_cost[MAX_NETS];     //!< Cost of each touched net after the evaluated swap.
+    int net_stamp[MAX_NETS];        //!< Per-net marker to deduplicate touched nets.
+    int touched[MAX_NETS];          //!< Nets touched by the evaluated swap.
+    int n_touched=0;                //!< Number of touched nets.
+    int stamp=0;                    //!< Current marker value.
+  };
+
+}
+
+#endif
@@ -7,16 +7,60 @@
 
 #include "spatial.h"
 #include <algorithm>
+#include <numeric>
+#include <thread>
+
+// calcCost uses all cores for netlists with at least this many nets
+#define PARALLEL_COST_MIN_NETS 50000
+
+// nets gathered per call of the bounding box kernels by calcCost
+#define COST_KERNEL_LANES 256
+
+// nets are sorted by pin count within consecutive spans of this many net IDs,
+// a global sort would revisit the whole block list once per pin count
+#define DEGREE_SORT_SPAN 4096
 
 using namespace sp;
 
 
+// dispatch to the cost model policy selected at runtime, each case 
+// instantiates the templated cost loop so that no branch remains inside it
+#define COST_MODEL_SWITCH(call) \
+  switch (cost_model) { \
+    case CostModel::WeightedHPWL: {typedef WeightedHPWLModel Model; call;} \
+    case CostModel::SquaredDist: {typedef SquaredDistModel Model; call;} \
+    case CostModel::Star: {typedef StarModel Model; call;} \
+    default: {typedef HPWLModel Model; call;} \
+  }
+
+namespace {
+
+  // fill a bounding box accumulator from the high fanout coordinate multisets
+  bool highFanoutAcc(BBoxAcc &acc, const QMap<int,int> &xs, const QMap<int,int> &ys)
+  {
+    acc.x_min = xs.firstKey();
+    acc.x_max = xs.lastKey();
+    acc.y_min = ys.firstKey();
+    acc.y_max = ys.lastKey();
+    return true;
+  }
+
+  // the multisets don't hold enough information for other accumulators
+  bool highFanoutAcc(MomentAcc &, const QMap<int,int> &, const QMap<int,int> &)
+  {
+    return false;
+  }
+
+}
+
+
 // Graph class implementations
 
 Graph::Graph(int n_blocks, int n_nets)
 {
   all_block_net_ids.resize(n_blocks);
   nets.resize(n_nets);
+  net_weights.fill(1, n_nets);
 }
 
 void Graph::setNet(int net_id, const QList<int> &conn_blocks)
@@ -41,7 +85,211 @@ bool Graph::allBlocksConnected() const
 
 // Chip class implementations
 
-Chip::Chip(const QString &f_path)
+template<class Model>
+qint64 Chip::netCost(int net_id) const
+{
+  int hf_ind = hf_net_inds[net_id];
+  typename Model::Acc acc;
+  if (hf_ind < 0 || !highFanoutAcc(acc, hf_xs[hf_ind], hf_ys[hf_ind])) {
+    return netCostScan<Model>(net_id);
+  }
+  return graph->netWeight(net_id) * Model::cost(acc, graph->getNet(net_id).size());
+}
+
+template<class Model>
+qint64 Chip::netCostScan(int net_id) const
+{
+  const QList<int> &net = graph->getNet(net_id);
+  typename Model::Acc acc;
+  for (int b_id : net) {
+    acc.add(block_locs[b_id].first, block_locs[b_id].second);
+  }
+  return graph->netWeight(net_id) * Model::cost(acc, net.size());
+}
+
+template<class Model>
+qint64 Chip::sumNetCosts(int begin, int end) const
+{
+  qint64 calc_cost = 0;
+  // add the partial cost of each net, the range holds the same net IDs in ID
+  // order and degree order
+  for (int net_id=begin; net_id<end; net_id++) {
+    calc_cost += netCost<Model>(net_id);
+  }
+  return calc_cost;
+}
+
+template<class Model>
+qint64 Chip::sumSpanNetCosts(int begin, int end) const
+{
+  QVector<int> xs(COST_KERNEL_LANES * BBOX_PIN_SLOTS, 0);
+  QVector<int> ys(COST_KERNEL_LANES * BBOX_PIN_SLOTS, 0);
+  QVector<int> spans(COST_KERNEL_LANES);
+  QVector<qint64> factors(COST_KERNEL_LANES);
+  qint64 calc_cost = 0;
+  int pos = begin;
+  while (pos < end) {
+    int degree = graph->getNet(degree_order[pos]).size();
+    if (degree < 2 || degree > BBOX_PIN_SLOTS || hf_net_inds[degree_order[pos]] >= 0) {
+      calc_cost += netCost<Model>(degree_order[pos++]);
+      continue;
+    }
+    // gather a run of nets of this degree with exactly degree pin slots, 
+    // lanes past the end of the run hold stale coordinates and are ignored
+    int n_lanes = 0;
+    while (pos < end && n_lanes < COST_KERNEL_LANES) {
+      int net_id = degree_order[pos];
+      const QList<int> &net = graph->getNet(net_id);
+      if (net.size() != degree || hf_net_inds[net_id] >= 0) {
+        break;
+      }
+      int base = (n_lanes / BBOX_GROUP_LANES) * degree * BBOX_GROUP_LANES 
+        + n_lanes % BBOX_GROUP_LANES;
+      for (int k=0; k<degree; k++) {
+        const QPair<int,int> &loc = block_locs[net[k]];
+        xs[base + k * BBOX_GROUP_LANES] = loc.first;
+        ys[base + k * BBOX_GROUP_LANES] = loc.second;
+      }
+      factors[n_lanes++] = (qint64)graph->netWeight(net_id) * Model::spanFactor(degree);
+      pos++;
+    }
+    int n_groups = (n_lanes + BBOX_GROUP_LANES - 1) / BBOX_GROUP_LANES;
+    bboxSpans(simd_level, xs.constData(), ys.constData(), n_groups, degree,
+        Model::Y_WEIGHT, spans.data());
+    for (int lane=0; lane<n_lanes; lane++) {
+      calc_cost += factors[lane] * spans[lane];
+    }
+  }
+  return calc_cost;
+}
+
+// the bounding box span models take the batched kernel path
+template<>
+qint64 Chip::sumNetCosts<HPWLModel>(int begin, int end) const
+{
+  return sumSpanNetCosts<HPWLModel>(begin, end);
+}
+
+template<>
+qint64 Chip::sumNetCosts<WeightedHPWLModel>(int begin, int end) const
+{
+  return sumSpanNetCosts<WeightedHPWLModel>(begin, end);
+}
+
+template<class Model>
+qint64 Chip::sumNetCostsParallel(int n_threads) const
+{
+  if (n_threads <= 1) {
+    return sumNetCosts<Model>(0, n_nets);
+  }
+  // split the degree order at sort span boundaries into ranges of about 
+  // equal pin counts, integer sums don't depend on the order so the total 
+  // matches the serial one
+  QVector<int> bounds(n_threads + 1);
+  for (int t=0; t<n_threads; t++) {
+    long pins = degree_pins.last() * t / n_threads;
+    int pos = std::lower_bound(degree_pins.begin(), degree_pins.end(), pins) 
+      - degree_pins.begin();
+    bounds[t] = std::min((pos + DEGREE_SORT_SPAN/2) / DEGREE_SORT_SPAN * DEGREE_SORT_SPAN, n_nets);
+  }
+  bounds[n_threads] = n_nets;
+  QVector<qint64> partial_costs(n_threads, 0);
+  std::vector<std::thread> threads;
+  for (int t=1; t<n_threads; t++) {
+    threads.push_back(std::thread([this, t, &bounds, &partial_costs]() {
+      partial_costs[t] = sumNetCosts<Model>(bounds[t], bounds[t+1]);
+    }));
+  }
+  partial_costs[0] = sumNetCosts<Model>(bounds[0], bounds[1]);
+  qint64 calc_cost = partial_costs[0];
+  for (int t=1; t<n_threads; t++) {
+    threads[t-1].join();
+    calc_cost += partial_costs[t];
+  }
+  return calc_cost;
+}
+
+template<class Model>
+qint64 Chip::swapCostDelta(int x1, int y1, int x2, int y2, int bid_1, int bid_2)
+{
+  // calculate the cost of Nets associated with the provided block IDs
+  auto associatedNetCosts = [this, bid_1, bid_2]() {
+    qint64 cost = 0;
+    QSet<int> accounted_nets;
+    for (int bid : {bid_1, bid_2}) {
+      if (bid == -1) {
+        continue;
+      }
+      for (int net_id : graph->blockNets(bid)) {
+        if (!accounted_nets.contains(net_id) && !skipsNet(net_id)) {
+          accounted_nets.insert(net_id);
+          cost += netCost<Model>(net_id);
+        }
+      }
+    }
+    return cost;
+  };
+
+  // compute the cost of nets associated with the blocks before the change
+  qint64 cost_i = associatedNetCosts();
+
+  // perform the swap
+  bool journaling_i = journaling;
+  journaling = false;
+  setLocBlock(qMakePair(x1, y1), bid_2);
+  setLocBlock(qMakePair(x2, y2), bid_1);
+
+  // compute the cost of nets associated with the blocks after the change
+  qint64 cost_f = associatedNetCosts();
+
+  // swap back
+  setLocBlock(qMakePair(x1, y1), bid_1);
+  setLocBlock(qMakePair(x2, y2), bid_2);
+  journaling = journaling_i;
+
+  return cost_f - cost_i;
+}
+
+template<class Model>
+qint64 Chip::moveCostDelta(const QVector<QPair<int,int>> &from,
+    const QVector<QPair<int,int>> &to)
+{
+  // nets of all blocks being moved
+  QSet<int> accounted_nets;
+  QList<int> nets;
+  for (const QPair<int,int> &cell : from) {
+    int bid = blockIdAt(cell);
+    if (bid == -1) {
+      continue;
+    }
+    for (int net_id : graph->blockNets(bid)) {
+      if (!accounted_nets.contains(net_id) && !skipsNet(net_id)) {
+        accounted_nets.insert(net_id);
+        nets.append(net_id);
+      }
+    }
+  }
+  auto netCosts = [this, &nets]() {
+    qint64 cost = 0;
+    for (int net_id : nets) {
+      cost += netCost<Model>(net_id);
+    }
+    return cost;
+  };
+
+  qint64 cost_i = netCosts();
+  bool journaling_i = journaling;
+  journaling = false;
+  applyMove(from, to);
+  qint64 cost_f = netCosts();
+  applyMove(to, from);
+  journaling = journaling_i;
+  return cost_f - cost_i;
+}
+
+
+Chip::Chip(const QString &f_path, bool rcm_renumber, GridLayout t_layout)
+  : layout(t_layout)
 {
   QFile in_file(f_path);
   if (!in_file.open(QFile::ReadOnly | QFile::Text)) {
@@ -91,6 +339,27 @@ Chip::Chip(const QString &f_path)
       " to anything";
   }
 
+  if (rcm_renumber) {
+    renumberRCM();
+  }
+  initDegreeOrder();
+
+  // initialize 2D grid and block list
+  initEmptyPlacements();
+
+  initialized = true;
+}
+
+Chip::Chip(int nx, int ny, int n_blocks, const QVector<QList<int>> &nets,
+    GridLayout t_layout)
+  : nx(nx), ny(ny), n_blocks(n_blocks), n_nets(nets.size()), layout(t_layout)
+{
+  graph = new Graph(n_blocks, n_nets);
+  for (int net_id=0; net_id<n_nets; net_id++) {
+    graph->setNet(net_id, nets[net_id]);
+  }
+  initDegreeOrder();
+
   // initialize 2D grid and block list
   initEmptyPlacements();
 
@@ -106,16 +375,8 @@ void Chip::initEmptyPlacements()
 {
   cost = -1;
 
-  // initialize 2D grid
-  grid.clear();
-  grid.resize(nx);
-  for (int x=0; x<nx; x++) {
-    grid[x].clear();
-    grid[x].resize(ny);
-    for (int y=0; y<ny; y++) {
-      grid[x][y] = -1;  // initialize to be empty
-    }
-  }
+  // initialize grid, padding cells of tiled and Morton layouts stay empty
+  initCellStorage();
 
   // initialize blocks list
   block_locs.clear();
@@ -123,6 +384,238 @@ void Chip::initEmptyPlacements()
   for (auto &block_loc : block_locs) {
     block_loc = qMakePair(-1, -1);
   }
+
+  initHighFanoutNets();
+}
+
+void Chip::setHighFanoutThreshold(int threshold)
+{
+  hf_threshold = threshold;
+  initHighFanoutNets();
+}
+
+void Chip::initDegreeOrder()
+{
+  degree_order.resize(n_nets);
+  std::iota(degree_order.begin(), degree_order.end(), 0);
+  for (int span_begin=0; span_begin<n_nets; span_begin+=DEGREE_SORT_SPAN) {
+    std::stable_sort(degree_order.begin() + span_begin, 
+        degree_order.begin() + std::min(span_begin + DEGREE_SORT_SPAN, n_nets),
+        [this](int net_a, int net_b) {
+          return graph->getNet(net_a).size() < graph->getNet(net_b).size();
+        });
+  }
+  degree_pins.resize(n_nets + 1);
+  degree_pins[0] = 0;
+  for (int pos=0; pos<n_nets; pos++) {
+    degree_pins[pos+1] = degree_pins[pos] + graph->getNet(degree_order[pos]).size();
+  }
+}
+
+void Chip::initHighFanoutNets()
+{
+  hf_net_inds.fill(-1, n_nets);
+  block_hf_nets.clear();
+  block_hf_nets.resize(n_blocks);
+  hf_xs.clear();
+  hf_ys.clear();
+  if (hf_threshold < 0 || cost_model == CostModel::Star) {
+    // the multisets only serve bounding box models
+    return;
+  }
+  for (int net_id=0; net_id<n_nets; net_id++) {
+    const QList<int> &net = graph->getNet(net_id);
+    if (net.size() <= hf_threshold) {
+      continue;
+    }
+    int hf_ind = hf_xs.size();
+    hf_net_inds[net_id] = hf_ind;
+    hf_xs.append(QMap<int,int>());
+    hf_ys.append(QMap<int,int>());
+    for (int bid : net) {
+      block_hf_nets[bid].append(hf_ind);
+      hf_xs[hf_ind][block_locs[bid].first]++;
+      hf_ys[hf_ind][block_locs[bid].second]++;
+    }
+  }
+}
+
+void Chip::moveHighFanoutPins(int block_id, const QPair<int,int> &from,
+    const QPair<int,int> &to)
+{
+  auto movePin = [](QMap<int,int> &coords, int from_coord, int to_coord) {
+    if (from_coord == to_coord) {
+      return;
+    }
+    if (--coords[from_coord] == 0) {
+      coords.remove(from_coord);
+    }
+    coords[to_coord]++;
+  };
+  for (int hf_ind : block_hf_nets[block_id]) {
+    movePin(hf_xs[hf_ind], from.first, to.first);
+    movePin(hf_ys[hf_ind], from.second, to.second);
+  }
+}
+
+void Chip::setGridLayout(GridLayout t_layout)
+{
+  if (t_layout == layout) {
+    return;
+  }
+  // the occupied cells are found through the block locations, so sparse 
+  // chips are never scanned cell by cell
+  layout = t_layout;
+  initCellStorage();
+  for (int bid=0; bid<n_blocks; bid++) {
+    if (block_locs[bid].first >= 0) {
+      setCell(block_locs[bid].first, block_locs[bid].second, bid);
+    }
+  }
+}
+
+void Chip::initCellStorage()
+{
+  grid.clear();
+  sparse_cells.clear();
+  sparse_count = 0;
+  if (layout == GridLayout::SparseHash) {
+    int capacity = 16;
+    while (capacity < 2 * n_blocks) {
+      capacity *= 2;
+    }
+    resizeSparseCells(capacity);
+  }
+
+  const int tile_dim = 8;
+  x_offsets.resize(nx);
+  y_offsets.resize(ny);
+  switch (layout) {
+    case GridLayout::Tiled:
+    {
+      int tiles_x = (nx + tile_dim - 1) / tile_dim;
+      int tiles_y = (ny + tile_dim - 1) / tile_dim;
+      int tile_size = tile_dim * tile_dim;
+      for (int x=0; x<nx; x++) {
+        x_offsets[x] = (x / tile_dim) * tile_size + x % tile_dim;
+      }
+      for (int y=0; y<ny; y++) {
+        y_offsets[y] = (y / tile_dim) * tiles_x * tile_size + (y % tile_dim) * tile_dim;
+      }
+      grid.fill(-1, tiles_x * tiles_y * tile_size);
+      break;
+    }
+    case GridLayout::Morton:
+    {
+      // interleave the low coordinate bits, x in the even and y in the odd
+      // bits, over the power of two square of the shorter side. The high 
+      // bits of the longer axis go on top and stack those squares, so that 
+      // each axis is only padded to its own power of two
+      int side_x = 1, side_y = 1;
+      while (side_x < nx) {
+        side_x *= 2;
+      }
+      while (side_y < ny) {
+        side_y *= 2;
+      }
+      int sq_bits = 0;
+      while ((1 << (sq_bits + 1)) <= std::min(side_x, side_y)) {
+        sq_bits++;
+      }
+      auto spread = [sq_bits](int v, int first_bit) {
+        int spread_v = (v >> sq_bits) << (2 * sq_bits);
+        for (int bit=0; bit<sq_bits; bit++) {
+          spread_v |= ((v >> bit) & 1) << (2 * bit + first_bit);
+        }
+        return spread_v;
+      };
+      for (int x=0; x<nx; x++) {
+        x_offsets[x] = spread(x, 0);
+      }
+      for (int y=0; y<ny; y++) {
+        y_offsets[y] = spread(y, 1);
+      }
+      grid.fill(-1, side_x * side_y);
+      break;
+    }
+    default:
+      // column-major, the sparse table uses these as cell keys
+      for (int x=0; x<nx; x++) {
+        x_offsets[x] = x * ny;
+      }
+      for (int y=0; y<ny; y++) {
+        y_offsets[y] = y;
+      }
+      if (layout == GridLayout::ColumnMajor) {
+        grid.fill(-1, nx * ny);
+      }
+      break;
+  }
+}
+
+void Chip::setCell(int x, int y, int block_id)
+{
+  int cell_ind = cellIndex(x, y);
+  if (layout != GridLayout::SparseHash) {
+    grid[cell_ind] = block_id;
+    return;
+  }
+  int mask = sparse_cells.size() - 1;
+  int slot = sparseSlot(cell_ind);
+  while (sparse_cells[slot].first >= 0 && sparse_cells[slot].first != cell_ind) {
+    slot = (slot + 1) & mask;
+  }
+  if (block_id >= 0) {
+    // insert or overwrite
+    if (sparse_cells[slot].first < 0) {
+      sparse_cells[slot].first = cell_ind;
+      sparse_count++;
+    }
+    sparse_cells[slot].second = block_id;
+    if (2 * sparse_count > sparse_cells.size()) {
+      resizeSparseCells(2 * sparse_cells.size());
+    }
+    return;
+  }
+  if (sparse_cells[slot].first < 0) {
+    return; // already empty
+  }
+  // backward shift deletion, move later entries of the probe sequence into 
+  // the hole unless their home slot lies cyclically after the hole
+  int hole = slot;
+  for (int next=(hole+1)&mask; sparse_cells[next].first >= 0; next=(next+1)&mask) {
+    int home = sparseSlot(sparse_cells[next].first);
+    bool stays = (hole <= next) ? (hole < home && home <= next)
+      : (hole < home || home <= next);
+    if (!stays) {
+      sparse_cells[hole] = sparse_cells[next];
+      hole = next;
+    }
+  }
+  sparse_cells[hole] = qMakePair(-1, -1);
+  sparse_count--;
+}
+
+void Chip::resizeSparseCells(int capacity)
+{
+  QVector<QPair<int,int>> old_cells = sparse_cells;
+  sparse_cells.fill(qMakePair(-1, -1), capacity);
+  sparse_shift = 32;
+  while ((1 << (32 - sparse_shift)) < capacity) {
+    sparse_shift--;
+  }
+  sparse_count = 0;
+  int mask = capacity - 1;
+  for (const QPair<int,int> &cell : old_cells) {
+    if (cell.first >= 0) {
+      int slot = sparseSlot(cell.first);
+      while (sparse_cells[slot].first >= 0) {
+        slot = (slot + 1) & mask;
+      }
+      sparse_cells[slot] = cell;
+      sparse_count++;
+    }
+  }
 }
 
 QList<int> Chip::netBlockIds(int net_id) const
@@ -141,28 +634,40 @@ QList<QPair<int,int>> Chip::netCoords(int net_id) const
 
 void Chip::setLocBlock(const QPair<int,int> &loc, int block_id)
 {
-  grid[loc.first][loc.second] = block_id;
+  if (journaling && journal_locs.isEmpty()) {
+    if (journal.size() < n_blocks) {
+      JournalEntry entry = {loc, blockIdAt(loc), block_id};
+      journal.append(entry);
+    } else {
+      snapshotJournal();
+    }
+  }
+  setCell(loc.first, loc.second, block_id);
   if (block_id >= 0) {
+    if (!block_hf_nets[block_id].isEmpty()) {
+      moveHighFanoutPins(block_id, block_locs[block_id], loc);
+    }
     block_locs[block_id] = loc;
   }
 }
 
-int Chip::calcCost()
+qint64 Chip::calcCost()
 {
   if (block_locs.isEmpty()) {
     qWarning() << "Should not call calcCost before block locations have been "
       "initialized.";
     return -1;
   }
-  int calc_cost = 0;
-  // add the partial cost of each net
-  for (int net_id=0; net_id<n_nets; net_id++) {
-    calc_cost += costOfNet(net_id);
+  int n_threads = cost_threads;
+  if (n_threads <= 0) {
+    n_threads = (n_nets >= PARALLEL_COST_MIN_NETS) 
+      ? std::max((int)std::thread::hardware_concurrency(), 1) : 1;
   }
-  return calc_cost;
+  n_threads = std::min(n_threads, std::max(n_nets, 1));
+  COST_MODEL_SWITCH(return sumNetCostsParallel<Model>(n_threads));
 }
 
-int Chip::calcSwapCostDelta(int x1, int y1, int x2, int y2)
+qint64 Chip::calcSwapCostDelta(int x1, int y1, int x2, int y2)
 {
   if (block_locs.isEmpty()) {
     qWarning() << "Should not call calcSwapCostDelta before block locations "
@@ -170,47 +675,417 @@ int Chip::calcSwapCostDelta(int x1, int y1, int x2, int y2)
     return -1;
   }
 
-  int bid_1 = grid[x1][y1];
-  int bid_2 = grid[x2][y2];
+  int bid_1 = blockIdAt(x1, y1);
+  int bid_2 = blockIdAt(x2, y2);
 
   // if swapping between two empty blocks, no change
   if (bid_1 == -1 && bid_2 == -1) {
     return 0;
   }
 
-  // calculate the cost of Nets associated with the provided block IDs
-  auto associatedNetCosts = [this, bid_1, bid_2]() {
-    int cost = 0;
-    QSet<int> accounted_nets;
+  COST_MODEL_SWITCH(return swapCostDelta<Model>(x1, y1, x2, y2, bid_1, bid_2));
+}
+
+void Chip::calcSwapCostDeltas(const QVector<SwapCandidate> &swaps,
+    QVector<qint64> &deltas)
+{
+  deltas.fill(0, swaps.size());
+  switch (cost_model) {
+    case CostModel::HPWL:
+      spanSwapCostDeltas<HPWLModel>(swaps, deltas);
+      return;
+    case CostModel::WeightedHPWL:
+      spanSwapCostDeltas<WeightedHPWLModel>(swaps, deltas);
+      return;
+    default:
+      for (int i=0; i<swaps.size(); i++) {
+        const SwapCandidate &s = swaps[i];
+        deltas[i] = calcSwapCostDelta(s.x1, s.y1, s.x2, s.y2);
+      }
+      return;
+  }
+}
+
+template<class Model>
+void Chip::spanSwapCostDeltas(const QVector<SwapCandidate> &swaps,
+    QVector<qint64> &deltas)
+{
+
+  // gather the pins of every net twice, before and after its swap, into 
+  // lanes weighted by -1 and +1 times the net's cost factor
+  batch_lanes.clear();
+  for (int i=0; i<swaps.size(); i++) {
+    const SwapCandidate &s = swaps[i];
+    int bid_1 = blockIdAt(s.x1, s.y1);
+    int bid_2 = blockIdAt(s.x2, s.y2);
+    batch_nets.clear();
+    bool batchable = true;
     for (int bid : {bid_1, bid_2}) {
       if (bid == -1) {
         continue;
       }
       for (int net_id : graph->blockNets(bid)) {
-        if (!accounted_nets.contains(net_id)) {
-          accounted_nets.insert(net_id);
-          cost += costOfNet(net_id);
+        if (skipsNet(net_id)) {
+          continue;
+        }
+        batchable &= hf_net_inds[net_id] < 0;
+        if (!batch_nets.contains(net_id)) {
+          batch_nets.append(net_id);
         }
       }
     }
-    return cost;
+    if (!batchable) {
+      deltas[i] = calcSwapCostDelta(s.x1, s.y1, s.x2, s.y2);
+      continue;
+    }
+    for (int net_id : batch_nets) {
+      const QList<int> &net = graph->getNet(net_id);
+      qint64 factor = (qint64)graph->netWeight(net_id) * Model::spanFactor(net.size());
+      if (net.size() > BBOX_PIN_SLOTS) {
+        // too large for a lane, scan the pins before and after directly
+        BBoxAcc acc_before, acc_after;
+        for (int bid : net) {
+          QPair<int,int> loc = block_locs[bid];
+          acc_before.add(loc.first, loc.second);
+          if (bid == bid_1) {
+            loc = qMakePair(s.x2, s.y2);
+          } else if (bid == bid_2) {
+            loc = qMakePair(s.x1, s.y1);
+          }
+          acc_after.add(loc.first, loc.second);
+        }
+        deltas[i] += factor * (Model::span(acc_after) - Model::span(acc_before));
+        continue;
+      }
+      for (int after=0; after<2; after++) {
+        int lane = batch_lanes.size();
+        if (lane % BBOX_GROUP_LANES == 0) {
+          // zeroed lanes have no span, so a partial last group adds nothing
+          batch_xs.resize(lane * BBOX_PIN_SLOTS + BBOX_GROUP_INTS);
+          batch_ys.resize(lane * BBOX_PIN_SLOTS + BBOX_GROUP_INTS);
+          std::fill(batch_xs.end() - BBOX_GROUP_INTS, batch_xs.end(), 0);
+          std::fill(batch_ys.end() - BBOX_GROUP_INTS, batch_ys.end(), 0);
+        }
+        int base = (lane / BBOX_GROUP_LANES) * BBOX_GROUP_INTS + lane % BBOX_GROUP_LANES;
+        for (int k=0; k<BBOX_PIN_SLOTS; k++) {
+          // unused slots repeat the first pin
+          int bid = net[k < net.size() ? k : 0];
+          QPair<int,int> loc = block_locs[bid];
+          if (after && bid == bid_1) {
+            loc = qMakePair(s.x2, s.y2);
+          } else if (after && bid == bid_2) {
+            loc = qMakePair(s.x1, s.y1);
+          }
+          batch_xs[base + k * BBOX_GROUP_LANES] = loc.first;
+          batch_ys[base + k * BBOX_GROUP_LANES] = loc.second;
+        }
+        batch_lanes.append(qMakePair(i, after ? factor : -factor));
+      }
+    }
+  }
+
+  int n_groups = (batch_lanes.size() + BBOX_GROUP_LANES - 1) / BBOX_GROUP_LANES;
+  batch_spans.resize(n_groups * BBOX_GROUP_LANES);
+  bboxSpans(simd_level, batch_xs.constData(), batch_ys.constData(), n_groups,
+      BBOX_PIN_SLOTS, Model::Y_WEIGHT, batch_spans.data());
+  for (int lane=0; lane<batch_lanes.size(); lane++) {
+    deltas[batch_lanes[lane].first] += batch_lanes[lane].second * batch_spans[lane];
+  }
+}
+
+void Chip::setSimdLevel(SimdLevel level)
+{
+  simd_level = std::min(level, detectSimdLevel());
+}
+
+void Chip::renumberRCM()
+{
+  // block adjacency through shared nets, large nets would make the graph 
+  // dense without saying much about locality so they are skipped
+  const int max_adj_net_size = 32;
+  QVector<QVector<int>> adj(n_blocks);
+  for (const QList<int> &net : graph->getNets()) {
+    if (net.size() > max_adj_net_size) {
+      continue;
+    }
+    for (int bid : net) {
+      for (int n_bid : net) {
+        if (n_bid != bid) {
+          adj[bid].append(n_bid);
+        }
+      }
+    }
+  }
+  for (QVector<int> &neighbors : adj) {
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+  }
+  auto byDegree = [&adj](int a, int b) {
+    return adj[a].size() < adj[b].size() || (adj[a].size() == adj[b].size() && a < b);
   };
 
-  // compute the cost of nets associated with the blocks before the change
-  int cost_i = associatedNetCosts();
+  // Cuthill-McKee BFS per connected component, starting from the lowest 
+  // degree unvisited block and visiting neighbors in increasing degree
+  QVector<int> by_degree(n_blocks);
+  std::iota(by_degree.begin(), by_degree.end(), 0);
+  std::sort(by_degree.begin(), by_degree.end(), byDegree);
+  QVector<bool> visited(n_blocks, false);
+  QVector<int> order;
+  order.reserve(n_blocks);
+  for (int start : by_degree) {
+    if (visited[start]) {
+      continue;
+    }
+    visited[start] = true;
+    int head = order.size();
+    order.append(start);
+    while (head < order.size()) {
+      int bid = order[head++];
+      QVector<int> next;
+      for (int n_bid : adj[bid]) {
+        if (!visited[n_bid]) {
+          visited[n_bid] = true;
+          next.append(n_bid);
+        }
+      }
+      std::sort(next.begin(), next.end(), byDegree);
+      order += next;
+    }
+  }
+  std::reverse(order.begin(), order.end());
 
-  // perform the swap
-  setLocBlock(qMakePair(x1, y1), bid_2);
-  setLocBlock(qMakePair(x2, y2), bid_1);
+  // relabel blocks, then order nets by their lowest new block ID
+  QVector<int> new_ids(n_blocks);
+  for (int new_id=0; new_id<n_blocks; new_id++) {
+    new_ids[order[new_id]] = new_id;
+  }
+  QVector<QList<int>> nets = graph->getNets();
+  for (QList<int> &net : nets) {
+    for (int &bid : net) {
+      bid = new_ids[bid];
+    }
+  }
+  auto lowestId = [](const QList<int> &net) {
+    return *std::min_element(net.begin(), net.end());
+  };
+  std::stable_sort(nets.begin(), nets.end(), [&lowestId](const QList<int> &a, 
+        const QList<int> &b) {return lowestId(a) < lowestId(b);});
 
-  // compute the cost of nets associated with the blocks after the change
-  int cost_f = associatedNetCosts();
+  delete graph;
+  graph = new Graph(n_blocks, n_nets);
+  for (int net_id=0; net_id<n_nets; net_id++) {
+    graph->setNet(net_id, nets[net_id]);
+  }
+  orig_block_ids = order;
+}
 
-  // swap back
-  setLocBlock(qMakePair(x1, y1), bid_1);
-  setLocBlock(qMakePair(x2, y2), bid_2);
+NetReduction Chip::preprocessNets()
+{
+  NetReduction reduction;
+  reduction.nets_before = n_nets;
 
-  return cost_f - cost_i;
+  // distinct blocks of each net, sorted so that equal sets compare equal
+  QVector<QVector<int>> block_sets(n_nets);
+  QVector<int> kept_net_ids;
+  for (int net_id=0; net_id<n_nets; net_id++) {
+    const QList<int> &net = graph->getNet(net_id);
+    reduction.pins_before += net.size();
+    QVector<int> &block_set = block_sets[net_id];
+    for (int bid : net) {
+      block_set.append(bid);
+    }
+    std::sort(block_set.begin(), block_set.end());
+    block_set.erase(std::unique(block_set.begin(), block_set.end()), block_set.end());
+    if (block_set.size() > 1) {
+      kept_net_ids.append(net_id);
+    }
+  }
+
+  // group nets with equal block sets, each group is represented by its 
+  // first net and the groups keep the original net order
+  QVector<int> sorted_ids = kept_net_ids;
+  std::stable_sort(sorted_ids.begin(), sorted_ids.end(), [&block_sets](int a, int b) 
+      {return block_sets[a] < block_sets[b];});
+  QVector<int> weights(n_nets, 0);
+  int group_first = -1;
+  for (int i=0; i<sorted_ids.size(); i++) {
+    int net_id = sorted_ids[i];
+    if (i == 0 || block_sets[net_id] != block_sets[sorted_ids[i-1]]) {
+      group_first = net_id;
+    }
+    weights[group_first] += graph->netWeight(net_id);
+  }
+
+  QVector<int> new_net_ids;
+  for (int net_id : kept_net_ids) {
+    if (weights[net_id] > 0) {
+      new_net_ids.append(net_id);
+    }
+  }
+  Graph *new_graph = new Graph(n_blocks, new_net_ids.size());
+  for (int new_id=0; new_id<new_net_ids.size(); new_id++) {
+    const QVector<int> &block_set = block_sets[new_net_ids[new_id]];
+    new_graph->setNet(new_id, block_set.toList());
+    new_graph->setNetWeight(new_id, weights[new_net_ids[new_id]]);
+    reduction.pins_after += block_set.size();
+  }
+  delete graph;
+  graph = new_graph;
+  n_nets = new_net_ids.size();
+  reduction.nets_after = n_nets;
+
+  initHighFanoutNets();
+  initDegreeOrder();
+  return reduction;
+}
+
+qint64 Chip::calcMoveCostDelta(const QVector<QPair<int,int>> &from,
+    const QVector<QPair<int,int>> &to)
+{
+  COST_MODEL_SWITCH(return moveCostDelta<Model>(from, to));
+}
+
+void Chip::applyMove(const QVector<QPair<int,int>> &from,
+    const QVector<QPair<int,int>> &to)
+{
+  QVector<int> bids(from.size());
+  for (int i=0; i<from.size(); i++) {
+    bids[i] = blockIdAt(from[i]);
+  }
+  for (int i=0; i<to.size(); i++) {
+    setLocBlock(to[i], bids[i]);
+  }
+}
+
+bool Chip::writePlacement(const QString &f_path)
+{
+  QFile f_out(f_path);
+  if (!f_out.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    qWarning() << "Unable to open" << f_path << "for writing.";
+    return false;
+  }
+  QTextStream out(&f_out);
+  out << n_blocks << " " << ny << " " << nx << "\n";
+  for (int bid=0; bid<n_blocks; bid++) {
+    out << origBlockId(bid) << " " << block_locs[bid].first << " " 
+      << block_locs[bid].second << "\n";
+  }
+  f_out.close();
+  return true;
+}
+
+bool Chip::readPlacement(const QString &f_path, QVector<QPair<int,int>> &locs)
+{
+  QFile in_file(f_path);
+  if (!in_file.open(QFile::ReadOnly | QFile::Text)) {
+    qWarning() << "Unable to open" << f_path << "for reading.";
+    return false;
+  }
+  // block IDs of the file are problem file IDs
+  QVector<int> block_ids(n_blocks);
+  for (int bid=0; bid<n_blocks; bid++) {
+    block_ids[origBlockId(bid)] = bid;
+  }
+  locs.fill(qMakePair(-1, -1), n_blocks);
+  bool header = true;
+  while (!in_file.atEnd()) {
+    QStringList line_items = QString(in_file.readLine()).trimmed().split(" ");
+    if (header) {
+      if (line_items.size() != 3) {
+        qWarning() << "First line of" << f_path << "must contain 3 values.";
+        return false;
+      }
+      header = false;
+      continue;
+    }
+    if (line_items.size() != 3) {
+      continue;
+    }
+    int orig_id = line_items[0].toInt();
+    int x = line_items[1].toInt();
+    int y = line_items[2].toInt();
+    if (orig_id >= 0 && orig_id < n_blocks && x >= 0 && x < nx 
+        && y >= 0 && y < ny) {
+      locs[block_ids[orig_id]] = qMakePair(x, y);
+    }
+  }
+  return !header;
+}
+
+void Chip::startJournal()
+{
+  journaling = true;
+  commitJournal();
+}
+
+void Chip::startJournal(const QVector<QPair<int,int>> &rollback_locs)
+{
+  journaling = true;
+  journal.clear();
+  journal_locs = rollback_locs;
+}
+
+void Chip::commitJournal()
+{
+  journal.clear();
+  journal_locs.clear();
+}
+
+void Chip::rollbackJournal()
+{
+  bool journaling_i = journaling;
+  journaling = false;
+  if (!journal_locs.isEmpty()) {
+    // empty the cells of all blocks before placing them at their old cells
+    for (int bid=0; bid<n_blocks; bid++) {
+      setLocBlock(block_locs[bid], -1);
+    }
+    for (int bid=0; bid<n_blocks; bid++) {
+      setLocBlock(journal_locs[bid], bid);
+    }
+  } else {
+    for (int i=journal.size()-1; i>=0; i--) {
+      setLocBlock(journal[i].loc, journal[i].prev_bid);
+    }
+  }
+  commitJournal();
+  journaling = journaling_i;
+}
+
+void Chip::stopJournal()
+{
+  journaling = false;
+  commitJournal();
+}
+
+QVector<QPair<int,int>> Chip::rollbackLocs() const
+{
+  if (!journal_locs.isEmpty()) {
+    return journal_locs;
+  }
+  // the earliest write of a cell holds the block it had at the rollback point
+  QVector<QPair<int,int>> locs = block_locs;
+  for (int i=journal.size()-1; i>=0; i--) {
+    if (journal[i].prev_bid >= 0) {
+      locs[journal[i].prev_bid] = journal[i].loc;
+    }
+  }
+  return locs;
+}
+
+void Chip::snapshotJournal()
+{
+  // undo to the rollback point, copy the block locations and redo
+  journaling = false;
+  for (int i=journal.size()-1; i>=0; i--) {
+    setLocBlock(journal[i].loc, journal[i].prev_bid);
+  }
+  journal_locs = block_locs;
+  for (const JournalEntry &entry : journal) {
+    setLocBlock(entry.loc, entry.bid);
+  }
+  journal.clear();
+  journaling = true;
 }
 
 void Chip::setGrid(const QVector<QVector<int>> &t_grid, bool skip_validation)
@@ -237,22 +1112,46 @@ void Chip::setGrid(const QVector<QVector<int>> &t_grid, bool skip_validation)
       }
     }
   }
-  grid = t_grid;
+  for (int x=0; x<nx; x++) {
+    for (int y=0; y<ny; y++) {
+      setCell(x, y, t_grid[x][y]);
+    }
+  }
   calcCost();
 }
 
 
-int Chip::costOfNet(int net_id) const
+QRect Chip::rangeWindow(const QPair<int,int> &center, int rw_dim) const
 {
-  int x_min=nx;
-  int x_max=0;
-  int y_min=ny;
-  int y_max=0;
-  for (int b_id : graph->getNet(net_id)) {
-    x_min = std::min(x_min, block_locs[b_id].first);
-    x_max = std::max(x_max, block_locs[b_id].first);
-    y_min = std::min(y_min, block_locs[b_id].second);
-    y_max = std::max(y_max, block_locs[b_id].second);
+  QRect rw_rect(center.first - std::floor(rw_dim/2), center.second - std::floor(rw_dim/2),
+      std::min(rw_dim, nx), std::min(rw_dim, ny));
+  if (rw_rect.top() < 0) {
+    rw_rect.moveTop(0);
+  }
+  if (rw_rect.left() < 0) {
+    rw_rect.moveLeft(0);
+  }
+  if (rw_rect.right() >= nx) {
+    rw_rect.moveRight(nx-1);
   }
-  return (x_max - x_min) + 2 * (y_max - y_min);
+  if (rw_rect.bottom() >= ny) {
+    rw_rect.moveBottom(ny-1);
+  }
+  return rw_rect;
+}
+
+qint64 Chip::costOfNet(int net_id) const
+{
+  COST_MODEL_SWITCH(return netCost<Model>(net_id));
+}
+
+qint64 Chip::costOfNetScan(int net_id) const
+{
+  COST_MODEL_SWITCH(return netCostScan<Model>(net_id));
+}
+
+void Chip::setCostModel(CostModel t_cost_model)
+{
+  cost_model = t_cost_model;
+  initHighFanoutNets();
 }
@@ -10,6 +10,8 @@
 #define _SP_SPATIAL_H_
 
 #include <QtWidgets>
+#include "costmodel.h"
+#include "bboxkernels.h"
 
 namespace sp {
 
@@ -42,15 +44,60 @@ namespace sp {
     //! Return the net connectivity of a single net.
     const QList<int> &blockNets(int id) {return all_block_net_ids[id];}
 
+    //! Set the weight of the specified net, its cost is multiplied by this.
+    void setNetWeight(int net_id, int weight) {net_weights[net_id] = weight;}
+
+    //! Return the weight of the specified net.
+    int netWeight(int net_id) const {return net_weights[net_id];}
+
   private:
 
     //! List of nets where each net consists of a list of block IDs.
     QVector<QList<int>> nets;
     //! For each block, store a list of associated net IDs.
     QVector<QList<int>> all_block_net_ids;
+    //! Cost multiplier of each net, 1 unless nets were merged.
+    QVector<int> net_weights;
+  };
+
+  //! Netlist size before and after preprocessing.
+  struct NetReduction
+  {
+    int nets_before=0;  //!< Net count before preprocessing.
+    int nets_after=0;   //!< Net count after preprocessing.
+    int pins_before=0;  //!< Pin count before preprocessing.
+    int pins_after=0;   //!< Pin count after preprocessing.
+  };
+
+  //! Proposed swap of the contents of two cells.
+  struct SwapCandidate
+  {
+    int x1, y1;   //!< First cell.
+    int x2, y2;   //!< Second cell.
+  };
+
+  //! Cell write recorded by the placement journal of a chip.
+  struct JournalEntry
+  {
+    QPair<int,int> loc; //!< Cell written.
+    int prev_bid;       //!< Block ID at the cell before the write, -1 if empty.
+    int bid;            //!< Block ID written, -1 if emptied.
   };
 
 
+  //! Memory layout of the chip grid cells.
+  enum class GridLayout {
+    //! Cells stored column by column.
+    ColumnMajor,
+    //! Cells stored in 8x8 tiles, tiles stored row by row.
+    Tiled,
+    //! Cells stored in Z-order (Morton order) of their coordinates.
+    Morton,
+    //! Only occupied cells stored in an open addressing hash table, memory 
+    //! scales with the block count instead of the chip area.
+    SparseHash
+  };
+
   /*! \brief Chip spatial representation of blocks and nets.
    *
    * A chip containing certain numbers of rows and columns for blocks to be
@@ -60,7 +107,16 @@ namespace sp {
   {
   public:
     //! Constructor taking the problem file path to be read.
-    Chip(const QString &f_path);
+    //! Block IDs are renumbered by reverse Cuthill-McKee ordering if 
+    //! rcm_renumber is set, see origBlockId for the file IDs. The grid is 
+    //! allocated with the given layout.
+    Chip(const QString &f_path, bool rcm_renumber=false,
+        GridLayout t_layout=GridLayout::ColumnMajor);
+
+    //! Constructor taking the chip dimensions and the nets directly, each net
+    //! being a list of block IDs. The grid is allocated with the given layout.
+    Chip(int nx, int ny, int n_blocks, const QVector<QList<int>> &nets,
+        GridLayout t_layout=GridLayout::ColumnMajor);
 
     //! Destructor.
     ~Chip();
@@ -68,6 +124,16 @@ namespace sp {
     //! Clear all placements.
     void initEmptyPlacements();
 
+    //! Change the memory layout of the grid, keeping the current placement.
+    void setGridLayout(GridLayout t_layout);
+
+    //! Return the memory layout of the grid.
+    GridLayout gridLayout() const {return layout;}
+
+    //! Return the number of cells held by the dense grid storage, including 
+    //! the padding of the tiled and Morton layouts.
+    int gridStorageSize() const {return grid.size();}
+
     //! Return whether this chip has been successfully initialized.
     bool isInitialized() {return initialized;}
 
@@ -96,10 +162,11 @@ namespace sp {
     void setLocBlock(const QPair<int,int> &loc, int block_id);
 
     //! Return the block id at the specified cell coordinates.
-    int blockIdAt(int x, int y) {return grid[x][y];}
+    int blockIdAt(int x, int y) 
+    {return layout == GridLayout::SparseHash ? sparseBlockIdAt(cellIndex(x, y)) : grid[cellIndex(x, y)];}
 
     //! Overrided function taking a pair that represents the cell coordinates.
-    int blockIdAt(QPair<int,int> coord) {return grid[coord.first][coord.second];}
+    int blockIdAt(QPair<int,int> coord) {return blockIdAt(coord.first, coord.second);}
 
     //! Return the cell coordinates of the specified block as a pair.
     QPair<int,int> blockLoc(int block_id) {return block_locs[block_id];}
@@ -107,37 +174,285 @@ namespace sp {
     //! \brief Compute the cost of the current placement.
     //!
     //! Compute the cost of the current placement from scratch. Does not update 
-    //! the internal cost counter, use setCost to do that.
-    int calcCost();
+    //! the internal cost counter, use setCost to do that. The result is the 
+    //! same as summing costOfNet over all nets, regardless of the threads and
+    //! instruction set used. Totals are 64-bit since the squared and star 
+    //! models exceed the int range on netlists of about 100k blocks.
+    qint64 calcCost();
 
     //! Set the cost to the specified value.
-    void setCost(int t_cost) {cost = t_cost;}
+    void setCost(qint64 t_cost) {cost = t_cost;}
 
     //! Return the current stored cost of the problem without recalculating it.
-    int getCost() const {return cost;}
+    qint64 getCost() const {return cost;}
 
     //! Compute the cost delta for executing a swap between two coordinates.
+    //! Does not update the internal cost. Approximate if setApproxNetSize is
+    //! in effect, as are the other delta functions.
+    qint64 calcSwapCostDelta(int x1, int y1, int x2, int y2);
+
+    //! \brief Compute the cost deltas of a batch of swaps.
+    //!
+    //! The swaps must not share cells or nets, so that each delta holds no 
+    //! matter which of the other swaps are applied. Nets of up to 
+    //! BBOX_PIN_SLOTS pins are gathered into lanes and evaluated with the 
+    //! batched bounding box kernels for the HPWL and weighted HPWL models, 
+    //! larger nets are scanned directly. Swaps involving high fanout nets and
+    //! the other models are evaluated one by one.
+    void calcSwapCostDeltas(const QVector<SwapCandidate> &swaps, 
+        QVector<qint64> &deltas);
+
+    //! Set the instruction set of the batched evaluation, capped at the best
+    //! one supported by the running CPU.
+    void setSimdLevel(SimdLevel level);
+
+    //! Return the instruction set of the batched evaluation.
+    SimdLevel simdLevel() const {return simd_level;}
+
+    //! Set the number of threads used by calcCost, 0 to use all cores for 
+    //! netlists with many nets and a single thread otherwise.
+    void setCostThreads(int n_threads) {cost_threads = n_threads;}
+
+    //! Return the number of threads used by calcCost, 0 if decided by the 
+    //! net count.
+    int costThreads() const {return cost_threads;}
+
+    //! Compute the cost delta of moving the contents of each cell in from to
+    //! the cell at the same index in to, which must be a permutation of from.
     //! Does not update the internal cost.
-    int calcSwapCostDelta(int x1, int y1, int x2, int y2);
+    qint64 calcMoveCostDelta(const QVector<QPair<int,int>> &from,
+        const QVector<QPair<int,int>> &to);
+
+    //! Move the contents of each cell in from to the cell at the same index 
+    //! in to, which must be a permutation of from. Does not update the cost.
+    void applyMove(const QVector<QPair<int,int>> &from,
+        const QVector<QPair<int,int>> &to);
+
+    //! \brief Start recording block placements so that they can be undone.
+    //!
+    //! The current placement becomes the rollback point. Cell writes are 
+    //! recorded in a journal until it holds as many entries as there are 
+    //! blocks, from then on the block locations of the rollback point are 
+    //! kept instead, so that the memory stays within a small multiple of a 
+    //! placement copy no matter how many moves are made. The tentative moves
+    //! of the cost delta functions are not recorded.
+    void startJournal();
+
+    //! Start recording block placements with the provided block locations,
+    //! as returned by rollbackLocs, as the rollback point instead of the
+    //! current placement.
+    void startJournal(const QVector<QPair<int,int>> &rollback_locs);
+
+    //! Make the current placement the rollback point.
+    void commitJournal();
+
+    //! Restore the placement of the rollback point. Does not update the cost.
+    void rollbackJournal();
+
+    //! Stop recording block placements.
+    void stopJournal();
+
+    //! Return whether block placements are being recorded.
+    bool isJournaling() const {return journaling;}
+
+    //! Return the block locations of the rollback point.
+    QVector<QPair<int,int>> rollbackLocs() const;
+
+    //! Write the block locations to a placement file, a first line of 
+    //! "n_blocks ny nx" followed by "block_id x y" lines with the block IDs 
+    //! of the problem file. Return whether successful.
+    bool writePlacement(const QString &f_path);
+
+    //! \brief Read a placement file written by writePlacement.
+    //!
+    //! The file may have been written for another version of the netlist. 
+    //! Fill locs with the location of each block of this chip in the file,
+    //! matched by problem file ID, or (-1,-1) for blocks that are not in the
+    //! file or lie outside this chip. Does not change the placement. Return
+    //! whether the file could be read.
+    bool readPlacement(const QString &f_path, QVector<QPair<int,int>> &locs);
 
     //! Set the grid to the provided 2D matrix.
     void setGrid(const QVector<QVector<int>> &t_grid, bool skip_validation=false);
     
-    //! Calculate and return the cost of the specified net ID.
-    int costOfNet(int net_id) const;
+    //! Calculate and return the cost of the specified net ID. Nets with more
+    //! pins than the high fanout threshold read their bounding box from the 
+    //! maintained coordinate multisets instead of scanning their pins.
+    qint64 costOfNet(int net_id) const;
+
+    //! Calculate the cost of the specified net ID by scanning all its pins.
+    qint64 costOfNetScan(int net_id) const;
+
+    //! Set the net cost model, the cost of the placement must be recomputed.
+    void setCostModel(CostModel t_cost_model);
+
+    //! Return the net cost model.
+    CostModel costModel() const {return cost_model;}
+
+    //! Set the pin count above which nets keep sorted coordinate multisets, 
+    //! -1 to disable. The multisets are rebuilt from the current placement.
+    void setHighFanoutThreshold(int threshold);
+
+    //! Return the pin count above which nets keep coordinate multisets.
+    int highFanoutThreshold() const {return hf_threshold;}
+
+    //! Return the number of nets above the high fanout threshold.
+    int numHighFanoutNets() const {return hf_xs.size();}
+
+    //! Set the pin count above which nets are left out of swap and move cost
+    //! deltas, -1 to evaluate all nets. The deltas are then approximate and 
+    //! the stored cost drifts from calcCost, which is always exact.
+    void setApproxNetSize(int max_pins) {approx_net_size = max_pins;}
+
+    //! Return the pin count above which nets are left out of cost deltas, -1
+    //! if deltas are exact.
+    int approxNetSize() const {return approx_net_size;}
+
+    //! Return the block ID in the problem file of the specified block.
+    int origBlockId(int block_id) const
+    {return orig_block_ids.isEmpty() ? block_id : orig_block_ids[block_id];}
+
+    //! \brief Shrink the netlist without changing the cost.
+    //!
+    //! Remove repeated pins within nets, drop nets that connect fewer than 
+    //! two distinct blocks (their cost is always zero) and merge nets with 
+    //! the same set of blocks into one net weighted by their count. Net IDs 
+    //! change, block IDs and the placement are kept.
+    NetReduction preprocessNets();
+
+    //! Return the rw_dim by rw_dim range window centered at the specified 
+    //! cell, shifted to be fully contained in the chip.
+    QRect rangeWindow(const QPair<int,int> &center, int rw_dim) const;
 
   private:
 
+    //! Return the index of the specified cell in the grid storage.
+    int cellIndex(int x, int y) const {return x_offsets[x] + y_offsets[y];}
+
+    //! Compute the per-axis cell index offsets of the current layout and 
+    //! allocate the empty cell storage.
+    void initCellStorage();
+
+    //! Set the block ID stored at the cell, -1 to empty it.
+    void setCell(int x, int y, int block_id);
+
+    //! Return the home slot of the cell index in the sparse table.
+    int sparseSlot(int cell_ind) const
+    {return (int)(((unsigned int)cell_ind * 2654435769u) >> sparse_shift);}
+
+    //! Return the block ID at the cell index in the sparse table, -1 if empty.
+    int sparseBlockIdAt(int cell_ind) const
+    {
+      int mask = sparse_cells.size() - 1;
+      for (int slot=sparseSlot(cell_ind); ; slot=(slot+1)&mask) {
+        if (sparse_cells[slot].first == cell_ind) {
+          return sparse_cells[slot].second;
+        } else if (sparse_cells[slot].first < 0) {
+          return -1;
+        }
+      }
+    }
+
+    //! Reallocate the sparse table with the specified power of two capacity,
+    //! keeping its entries.
+    void resizeSparseCells(int capacity);
+
+    //! Return the cost of the net under the cost model policy, from the 
+    //! high fanout multisets if the policy allows it.
+    template<class Model> qint64 netCost(int net_id) const;
+
+    //! Return the cost of the net under the cost model policy by scanning 
+    //! all its pins.
+    template<class Model> qint64 netCostScan(int net_id) const;
+
+    //! Sort the nets by pin count within spans of consecutive net IDs for the
+    //! full cost calculation.
+    void initDegreeOrder();
+
+    //! Return the cost of the nets at positions [begin, end) of degree_order
+    //! under the cost model policy. The range must start and end at sort 
+    //! span boundaries (or the net count), it then holds the net IDs in 
+    //! [begin, end).
+    template<class Model> qint64 sumNetCosts(int begin, int end) const;
+
+    //! sumNetCosts of the policies linear in the bounding box span. Runs of 
+    //! nets with the same pin count, up to BBOX_PIN_SLOTS, are evaluated by 
+    //! the batched bounding box kernels.
+    template<class Model> qint64 sumSpanNetCosts(int begin, int end) const;
+
+    //! Return the cost of all nets, split at sort span boundaries into ranges
+    //! of about equal pin counts that are summed by the given number of 
+    //! threads.
+    template<class Model> qint64 sumNetCostsParallel(int n_threads) const;
+
+    //! Swap cost delta under the cost model policy, see calcSwapCostDelta.
+    template<class Model> qint64 swapCostDelta(int x1, int y1, int x2, int y2, 
+        int bid_1, int bid_2);
+
+    //! calcSwapCostDeltas of the policies linear in the bounding box span.
+    template<class Model> void spanSwapCostDeltas(
+        const QVector<SwapCandidate> &swaps, QVector<qint64> &deltas);
+
+    //! Move cost delta under the cost model policy, see calcMoveCostDelta.
+    template<class Model> qint64 moveCostDelta(const QVector<QPair<int,int>> &from,
+        const QVector<QPair<int,int>> &to);
+
+    //! Return whether the net is left out of cost deltas.
+    bool skipsNet(int net_id) const
+    {return approx_net_size >= 0 && graph->getNet(net_id).size() > approx_net_size;}
+
+    //! Build the coordinate multisets of the nets above the high fanout 
+    //! threshold from the current block locations.
+    void initHighFanoutNets();
+
+    //! Replace the journal by the block locations of the rollback point.
+    void snapshotJournal();
+
+    //! Move the pins of a block in the high fanout multisets.
+    void moveHighFanoutPins(int block_id, const QPair<int,int> &from, 
+        const QPair<int,int> &to);
+
+    //! Renumber blocks by reverse Cuthill-McKee ordering of the block 
+    //! adjacency so that connected blocks get nearby IDs, and order nets by 
+    //! their lowest block ID. Must be called before placements are made.
+    void renumberRCM();
+
     // Private variables
     Graph *graph=nullptr;   //!< Graph object that holds the connectivities.
     bool initialized=false; //!< Indication of whether this chip is initialized.
-    int cost=-1;            //!< Current cost of the placement, -1 if no placement.
+    qint64 cost=-1;         //!< Current cost of the placement, -1 if no placement.
     int nx=0;               //!< Max cell count in the x direction.
     int ny=0;               //!< Max cell count in the y direction.
     int n_blocks=0;         //!< Number of blocks in the problem.
     int n_nets=0;           //!< Number of nets in the problem.
-    QVector<QVector<int>> grid; //!< A grid storing the block ID associated to each cell. -1 if empty.
+    GridLayout layout=GridLayout::ColumnMajor; //!< Memory layout of the grid.
+    QVector<int> x_offsets; //!< Grid storage offset contributed by each x coordinate.
+    QVector<int> y_offsets; //!< Grid storage offset contributed by each y coordinate.
+    QVector<int> grid;      //!< Block ID associated to each cell, -1 if empty, indexed by cellIndex.
+    QVector<QPair<int,int>> sparse_cells; //!< Linear probing table of (cell index, block ID), cell index -1 if free.
+    int sparse_count=0;     //!< Number of occupied cells in the sparse table.
+    int sparse_shift=32;    //!< Hash shift, 32 - log2 of the sparse table capacity.
     QVector<QPair<int,int>> block_locs; //!< Store all block locations.
+    QVector<int> orig_block_ids;  //!< Problem file ID of each block, empty if not renumbered.
+    CostModel cost_model=CostModel::HPWL; //!< Net cost model policy.
+    int hf_threshold=256;         //!< Nets with more pins than this keep coordinate multisets.
+    QVector<int> hf_net_inds;     //!< Index of each net in the multisets, -1 if not high fanout.
+    QVector<QVector<int>> block_hf_nets;  //!< Multiset indices of the high fanout nets of each block, once per pin.
+    QVector<QMap<int,int>> hf_xs; //!< Pin count at each x coordinate of the high fanout nets.
+    QVector<QMap<int,int>> hf_ys; //!< Pin count at each y coordinate of the high fanout nets.
+    SimdLevel simd_level=detectSimdLevel(); //!< Instruction set of the batched evaluation.
+    QVector<int> batch_xs;        //!< Pin x coordinates of the batched lanes.
+    QVector<int> batch_ys;        //!< Pin y coordinates of the batched lanes.
+    QVector<int> batch_spans;     //!< Bounding box spans of the batched lanes.
+    QVector<QPair<int,qint64>> batch_lanes;  //!< Swap index and cost factor of each lane.
+    QVector<int> batch_nets;      //!< Nets of the swap being gathered.
+    QVector<int> degree_order;    //!< Net IDs sorted by pin count within spans, ties by ID.
+    QVector<long> degree_pins;    //!< Pins of the nets before each position of degree_order.
+    int cost_threads=0;           //!< Threads of calcCost, 0 to decide by the net count.
+    int approx_net_size=-1;       //!< Nets above this pin count are left out of deltas, -1 for none.
+    bool journaling=false;        //!< Whether cell writes are recorded.
+    QVector<JournalEntry> journal;  //!< Cell writes since the rollback point.
+    QVector<QPair<int,int>> journal_locs; //!< Block locations of the rollback point once the journal outgrew them, empty otherwise.
 
   };
 
@@ -0,0 +1,53 @@
+/*!
+  \file placer_bench.cpp
+  \brief Microbenchmarks for the placer program, not run by ctest.
+  \author Samuel Ng
+  \date 2021-03-04 created
+  \copyright GNU LGPL v3
+  */
+
+#include <QtTest/QtTest>
+#include "placer/placer.h"
+
+class PlacerBench : public QObject
+{
+  Q_OBJECT
+
+  public:
+
+    //! Anneal a test problem with the range window and no compound or
+    //! directed moves from a fixed seed, using the specified move loop.
+    void benchLoop(bool specialized)
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.specialized_loop = specialized;
+      QBENCHMARK {
+        placer.setSeed(1);
+        placer.runPlacer(sa_settings);
+      }
+    }
+
+  // functions in these slots are automatically called after compilation
+  private slots:
+
+    //! Benchmark annealing with the generic move loop.
+    void benchGenericLoop()
+    {
+      benchLoop(false);
+    }
+
+    //! Benchmark annealing with the move loop compiled for the settings.
+    void benchSpecializedLoop()
+    {
+      benchLoop(true);
+    }
+
+};
+
+QTEST_MAIN(PlacerBench)
+#include "placer_bench.moc"  // generated at compile time
@@ -9,7 +9,15 @@
 #include <QtTest/QtTest>
 #include <QJsonObject>
 #include "placer/placer.h"
+#include "placer/quadratic.h"
+#include "placer/mincut.h"
+#include "placer/multilevel.h"
+#include "placer/detailed.h"
+#include "placer/greedy.h"
+#include "placer/smallplacer.h"
+#include "placer/eco.h"
 #include "gui/settings.h"
+#include "netlistgen.h"
 
 class PlacerTests : public QObject
 {
@@ -53,6 +61,62 @@ class PlacerTests : public QObject
       return json_obj.toVariantMap();
     }
 
+    //! Return whether every block of the chip is on its own cell and the
+    //! grid agrees with the block locations.
+    bool checkLegalPlacement(sp::Chip &chip)
+    {
+      QSet<QPair<int,int>> coord_set;
+      for (int bid=0; bid<chip.numBlocks(); bid++) {
+        QPair<int,int> loc = chip.blockLoc(bid);
+        if (coord_set.contains(loc) || chip.blockIdAt(loc) != bid) {
+          return false;
+        }
+        coord_set.insert(loc);
+      }
+      return true;
+    }
+
+    //! Run the placer on the chip by step calls from the initial placement 
+    //! until the cost falls to the given fraction of the initial cost, and 
+    //! return the moves attempted until then, -1 if the run ended before.
+    long movesToCostFraction(sp::Chip &chip, const pc::SASettings &sa_settings,
+        float cost_frac)
+    {
+      pc::Placer placer(&chip);
+      placer.init(sa_settings);
+      qint64 target_cost = cost_frac * chip.calcCost();
+      long moves = 0;
+      while (!placer.isDone()) {
+        pc::SAProgress progress = placer.step(64);
+        moves += progress.moves;
+        if (progress.cost <= target_cost) {
+          return moves;
+        }
+      }
+      return -1;
+    }
+
+    //! Make one move after another from the start of the first temperature 
+    //! step, hot enough for all of them to be accepted, and return how many
+    //! of the blocks were moved by the first n_blocks moves.
+    int blocksMovedInHotSweep(sp::Chip &chip, pc::SASettings sa_settings)
+    {
+      pc::Placer placer(&chip);
+      sa_settings.init_t_fact = 1e9;
+      placer.init(sa_settings);
+      QVector<bool> moved(chip.numBlocks(), false);
+      for (int i=0; i<chip.numBlocks(); i++) {
+        QVector<QPair<int,int>> locs;
+        for (int bid=0; bid<chip.numBlocks(); bid++) {
+          locs.append(chip.blockLoc(bid));
+        }
+        placer.step(1);
+        for (int bid=0; bid<chip.numBlocks(); bid++) {
+          moved[bid] = moved[bid] || chip.blockLoc(bid) != locs[bid];
+        }
+      }
+      return std::count(moved.begin(), moved.end(), true);
+    }
 
   // functions in these slots are automatically called after compilation
   private slots:
@@ -107,9 +171,9 @@ class PlacerTests : public QObject
       chip.setLocBlock(qMakePair(2,1), 2);
       chip.setLocBlock(qMakePair(3,1), 3);
       chip.setLocBlock(qMakePair(0,2), 4);
-      QCOMPARE(chip.costOfNet(0), 3);
-      QCOMPARE(chip.costOfNet(1), 2);
-      QCOMPARE(chip.calcCost(), 5);
+      QCOMPARE(chip.costOfNet(0), (qint64)3);
+      QCOMPARE(chip.costOfNet(1), (qint64)2);
+      QCOMPARE(chip.calcCost(), (qint64)5);
 
       // Locations layout 2:
       // Net 0: 0 1 2 3
@@ -124,29 +188,29 @@ class PlacerTests : public QObject
       chip.setLocBlock(qMakePair(2,2), 2);
       chip.setLocBlock(qMakePair(3,2), 3);
       chip.setLocBlock(qMakePair(1,1), 4);
-      QCOMPARE(chip.costOfNet(0), 3);
-      QCOMPARE(chip.costOfNet(1), 1);
-      QCOMPARE(chip.calcCost(), 4);
+      QCOMPARE(chip.costOfNet(0), (qint64)3);
+      QCOMPARE(chip.costOfNet(1), (qint64)1);
+      QCOMPARE(chip.calcCost(), (qint64)4);
 
       // Keep previous locations but verify the change in cost of potential 
       // swaps:
 
       // From layout 2, swap blocks 2 and 3 (no change in cost)
-      QCOMPARE(chip.calcSwapCostDelta(2, 2, 3, 2), 0);
+      QCOMPARE(chip.calcSwapCostDelta(2, 2, 3, 2), (qint64)0);
 
       // From layout 2, move block 0 to (1, 0)
       // x 0 x x
       // x 4 x 1
       // x x 2 3
       // x x x x
-      QCOMPARE(chip.calcSwapCostDelta(1, 0, 2, 1), 4);
+      QCOMPARE(chip.calcSwapCostDelta(1, 0, 2, 1), (qint64)4);
 
       // From layout 2, swap blocks 0 and 4
       // x x x x
       // x 0 4 1
       // x x 2 3
       // x x x x
-      QCOMPARE(chip.calcSwapCostDelta(1, 1, 2, 1), 1);
+      QCOMPARE(chip.calcSwapCostDelta(1, 1, 2, 1), (qint64)1);
     }
 
     /*! \brief Check random block placement initialization.
@@ -162,12 +226,7 @@ class PlacerTests : public QObject
       // init block positions randomly, manipulates the chip pointer directly
       placer.initBlockPos();
       // iterate through all blocks to see whether they have a uniqute location
-      QSet<QPair<int,int>> coord_set;
-      for (int bid=0; bid<chip.numBlocks(); bid++) {
-        QPair<int,int> loc = chip.blockLoc(bid);
-        QCOMPARE(coord_set.contains(loc), false);
-        coord_set.insert(loc);
-      }
+      QVERIFY(checkLegalPlacement(chip));
     }
 
     //! Validate that placement of a very trivial problem is successful.
@@ -182,7 +241,1030 @@ class PlacerTests : public QObject
       sa_settings.t_schd = pc::TSchd::StdDevTUpdate;
       sa_settings.max_its = 500;
       pc::SAResults results = placer.runPlacer(sa_settings);
-      QCOMPARE(results.cost, 1);
+      QCOMPARE(results.cost, (qint64)1);
+    }
+
+    /*! \brief Check the multilevel placement flow.
+     *
+     * Run a short multilevel placement on the ALU2 problem and check that all
+     * blocks end up on unique locations with a consistent cost.
+     */
+    void testMultilevelPlacement()
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.multilevel = true;
+      sa_settings.ml_coarsest_blocks = 50;
+      sa_settings.swap_fact = 2;
+      sa_settings.max_its = 50;
+      sa_settings.ml_refine_its = 10;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QVERIFY(checkLegalPlacement(chip));
+      QCOMPARE(results.cost, chip.calcCost());
+
+      // the coarse levels take the configuration and net weights of the 
+      // input chip
+      sp::Chip weighted(p_path, false, sp::GridLayout::SparseHash);
+      weighted.setCostModel(sp::CostModel::WeightedHPWL);
+      weighted.setHighFanoutThreshold(8);
+      for (int net_id=0; net_id<weighted.numNets(); net_id++) {
+        weighted.getGraph()->setNetWeight(net_id, 3);
+      }
+      pc::MultilevelPlacer ml(&weighted);
+      QVERIFY(ml.buildHierarchy(50));
+      for (sp::Chip *level : ml.coarseLevels()) {
+        QCOMPARE(level->gridLayout() == sp::GridLayout::SparseHash, true);
+        QCOMPARE(level->costModel() == sp::CostModel::WeightedHPWL, true);
+        QCOMPARE(level->highFanoutThreshold(), 8);
+        for (int net_id=0; net_id<level->numNets(); net_id++) {
+          QCOMPARE(level->getGraph()->netWeight(net_id), 3);
+        }
+      }
+    }
+
+    /*! \brief Check the quadratic initial placement.
+     *
+     * Check that the quadratic initial placement of the APEX1 problem places
+     * all blocks onto unique locations at a lower cost than the random 
+     * placement it starts from.
+     */
+    void testQuadraticInitPlacement()
+    {
+      QString p_path = ":/test_problems/apex1.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      qint64 rand_cost = chip.calcCost();
+      pc::QuadraticPlacer qp(&chip);
+      qint64 qp_cost = qp.place();
+      QCOMPARE(qp_cost, chip.calcCost());
+      QCOMPARE(qp_cost < rand_cost, true);
+      QVERIFY(checkLegalPlacement(chip));
+    }
+
+    //! Check that the min-cut placement of the APEX1 problem places all blocks
+    //! onto unique locations at a lower cost than a random placement.
+    void testMinCutInitPlacement()
+    {
+      QString p_path = ":/test_problems/apex1.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      qint64 rand_cost = chip.calcCost();
+      pc::MinCutPlacer mcp(&chip, 513);
+      qint64 mc_cost = mcp.place();
+      QCOMPARE(mc_cost, chip.calcCost());
+      QCOMPARE(mc_cost < rand_cost, true);
+      QVERIFY(checkLegalPlacement(chip));
+    }
+
+    //! Test that the sliding window detailed placer only improves the cost,
+    //! keeps the placement legal and stops at a window local minimum.
+    void testDetailedPlacement()
+    {
+      QString p_path = ":/test_problems/apex1.txt";
+      sp::Chip chip(p_path);
+      pc::MinCutPlacer mcp(&chip, 513);
+      qint64 mc_cost = mcp.place();
+      pc::DetailedPlacer dp(&chip);
+      qint64 delta = dp.refine(3, 2);
+      QCOMPARE(delta < 0, true);
+      QCOMPARE(mc_cost + delta, chip.calcCost());
+      QCOMPARE(pc::DetailedPlacer(&chip).refine(3, 2), (qint64)0);
+      QVERIFY(checkLegalPlacement(chip));
+    }
+
+    //! Test that the greedy improver reaches a local minimum with respect to
+    //! swaps within its window.
+    void testGreedyImprovement()
+    {
+      QString p_path = ":/test_problems/apex1.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      qint64 rand_cost = chip.calcCost();
+      pc::GreedyImprover gi(&chip);
+      int delta = gi.improve(5);
+      QCOMPARE(delta < 0, true);
+      QCOMPARE(rand_cost + delta, chip.calcCost());
+      for (int bid=0; bid<chip.numBlocks(); bid++) {
+        QPair<int,int> loc = chip.blockLoc(bid);
+        QCOMPARE(chip.blockIdAt(loc), bid);
+        for (int x=std::max(loc.first-2, 0); x<=std::min(loc.first+2, chip.dimX()-1); x++) {
+          for (int y=std::max(loc.second-2, 0); y<=std::min(loc.second+2, chip.dimY()-1); y++) {
+            QCOMPARE(chip.calcSwapCostDelta(loc.first, loc.second, x, y) >= 0, true);
+          }
+        }
+      }
+
+      // as the finishing phase, its evaluations are reported apart from moves
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.finish_mode = pc::FinishMode::GainFinish;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.evaluations > 0, true);
+    }
+
+    //! Test that the modified Lam schedule produces a consistent placement,
+    //! makes full cycles only on the plateau, where T settles, and freezes 
+    //! before exiting once the schedule is spent.
+    void testLamSchedule()
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.t_schd = pc::TSchd::LamTUpdate;
+      sa_settings.swap_fact = 1;
+      sa_settings.lam_its = 100;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      int cycle_attempts = sa_settings.swap_fact * pow(chip.numBlocks(), (4./3));
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.cost < results.init_cost, true);
+      QCOMPARE(results.iterations <= sa_settings.lam_its + 4, true);
+      QCOMPARE(results.moves < (long)results.iterations * cycle_attempts, true);
+
+      // follow the schedule step by step, the T a step runs at is reported 
+      // by the previous call
+      sp::Chip step_chip(p_path);
+      pc::Placer step_placer(&step_chip);
+      step_placer.init(sa_settings);
+      float T = step_placer.step(0).T;
+      float plateau_T_min = -1, plateau_T_max = -1, final_T = -1;
+      while (!step_placer.isDone()) {
+        pc::SAProgress progress = step_placer.step(1L << 40);
+        float frac = (float)(progress.iterations - 1) / sa_settings.lam_its;
+        if (frac < 0.15 || (frac >= 0.65 && frac < 1)) {
+          // fewer moves where nearly everything or nothing is accepted
+          QCOMPARE(progress.moves < cycle_attempts, true);
+          QCOMPARE(progress.moves >= (long)(sa_settings.lam_min_moves_fact 
+                * cycle_attempts), true);
+        } else if (frac < 0.65) {
+          QCOMPARE(progress.moves == cycle_attempts, true);
+          if (frac >= 0.3) {
+            plateau_T_min = (plateau_T_min < 0) ? T : std::min(plateau_T_min, T);
+            plateau_T_max = std::max(plateau_T_max, T);
+          }
+        }
+        if (progress.iterations == sa_settings.lam_its) {
+          final_T = T;
+        }
+        T = progress.T;
+      }
+      QCOMPARE(step_placer.results().iterations <= sa_settings.lam_its + 4, true);
+
+      // T varied by about 1.3x on the plateau and fell about 12x after it
+      QCOMPARE(plateau_T_min > 0, true);
+      QCOMPARE(plateau_T_max < 2 * plateau_T_min, true);
+      QCOMPARE(final_T > 0 && final_T < plateau_T_min / 4, true);
+    }
+
+    //! Test that the rejection-free phase keeps the tracked cost consistent
+    //! with the placement.
+    void testRejectionFreeSampling()
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.init_rw_dim = sa_settings.min_rw_dim;
+      sa_settings.rejection_free = true;
+      sa_settings.rf_threshold = 0.05;
+      sa_settings.sanity_check = true;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.cost < results.init_cost, true);
+      QVERIFY(checkLegalPlacement(chip));
+    }
+
+    //! Test that directed moves produce a legal placement with a consistent
+    //! cost, and that they reach a lower cost in fewer moves than random 
+    //! moves when cold.
+    void testDirectedMoves()
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.directed_ratio = 0.5;
+      sa_settings.directed_adaptive = true;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.cost < results.init_cost, true);
+      QVERIFY(checkLegalPlacement(chip));
+
+      // halving the cost of a random placement takes about 0.6 times the 
+      // random moves, summed over a few runs to even out the spread
+      sa_settings.directed_adaptive = false;
+      sa_settings.init_t_fact = 0.2;
+      long random_moves = 0, directed_moves = 0;
+      for (int i=0; i<5; i++) {
+        sp::Chip random_chip(p_path), directed_chip(p_path);
+        sa_settings.directed_ratio = 0;
+        long moves = movesToCostFraction(random_chip, sa_settings, 0.5);
+        QCOMPARE(moves > 0, true);
+        random_moves += moves;
+        sa_settings.directed_ratio = 0.5;
+        moves = movesToCostFraction(directed_chip, sa_settings, 0.5);
+        QCOMPARE(moves > 0, true);
+        directed_moves += moves;
+      }
+      QCOMPARE(directed_moves < random_moves, true);
+    }
+
+    //! Test that compound moves produce a legal placement with a consistent
+    //! cost and that the move cost delta matches the recalculated cost.
+    void testCompoundMoves()
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      qint64 cost = chip.calcCost();
+      QVector<QPair<int,int>> from, to;
+      from << chip.blockLoc(0) << chip.blockLoc(1) << chip.blockLoc(2);
+      to << chip.blockLoc(1) << chip.blockLoc(2) << chip.blockLoc(0);
+      int delta = chip.calcMoveCostDelta(from, to);
+      QCOMPARE(chip.calcCost(), cost);
+      chip.applyMove(from, to);
+      QCOMPARE(chip.calcCost(), cost + delta);
+
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.p_shift = 0.2;
+      sa_settings.p_rotate = 0.2;
+      sa_settings.p_cluster = 0.2;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      QVERIFY(checkLegalPlacement(chip));
+    }
+
+    //! Test that reverse Cuthill-McKee renumbering preserves the problem, 
+    //! that the sweep block orders produce a legal placement and that the 
+    //! shuffled sweep moves every block within a step.
+    void testSweepOrder()
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip chip(p_path);
+      sp::Chip rcm_chip(p_path, true);
+      QCOMPARE(rcm_chip.numBlocks(), chip.numBlocks());
+      QCOMPARE(rcm_chip.numNets(), chip.numNets());
+      QCOMPARE(rcm_chip.getGraph()->allBlocksConnected(), true);
+
+      // the same placement must have the same cost under both numberings
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      QSet<int> orig_ids;
+      for (int bid=0; bid<rcm_chip.numBlocks(); bid++) {
+        int orig_id = rcm_chip.origBlockId(bid);
+        QCOMPARE(orig_ids.contains(orig_id), false);
+        orig_ids.insert(orig_id);
+        rcm_chip.setLocBlock(chip.blockLoc(orig_id), bid);
+      }
+      QCOMPARE(rcm_chip.calcCost(), chip.calcCost());
+
+      for (pc::BlockOrder order : {pc::BlockOrder::ShuffledSweep, 
+          pc::BlockOrder::LocalitySweep}) {
+        pc::Placer rcm_placer(&rcm_chip);
+        pc::SASettings sa_settings;
+        sa_settings.gui_up = pc::GuiFinalOnly;
+        sa_settings.swap_fact = 1;
+        sa_settings.block_order = order;
+        pc::SAResults results = rcm_placer.runPlacer(sa_settings);
+        QCOMPARE(results.cost, rcm_chip.calcCost());
+        QCOMPARE(results.cost < results.init_cost, true);
+        QVERIFY(checkLegalPlacement(rcm_chip));
+      }
+
+      // a sweep picks every block once as the source of the first n_blocks
+      // moves, random picks leave about e^-2 of the blocks unmoved
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.block_order = pc::BlockOrder::ShuffledSweep;
+      sp::Chip sweep_chip(p_path);
+      QCOMPARE(blocksMovedInHotSweep(sweep_chip, sa_settings), 
+          sweep_chip.numBlocks());
+      sa_settings.block_order = pc::BlockOrder::RandomOrder;
+      sp::Chip random_chip(p_path);
+      QCOMPARE(blocksMovedInHotSweep(random_chip, sa_settings) 
+          < random_chip.numBlocks(), true);
+    }
+
+    //! Test that the grid layouts keep the placement when switched and 
+    //! produce a legal placement when annealing, and that the Morton layout
+    //! of elongated chips stays compact.
+    void testGridLayouts()
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip chip(p_path);
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      qint64 cost = chip.calcCost();
+      for (sp::GridLayout layout : {sp::GridLayout::Tiled, sp::GridLayout::Morton,
+          sp::GridLayout::SparseHash, sp::GridLayout::ColumnMajor}) {
+        chip.setGridLayout(layout);
+        QCOMPARE(chip.gridLayout() == layout, true);
+        QCOMPARE(chip.calcCost(), cost);
+        for (int bid=0; bid<chip.numBlocks(); bid++) {
+          QCOMPARE(chip.blockIdAt(chip.blockLoc(bid)), bid);
+        }
+      }
+
+      chip.setGridLayout(sp::GridLayout::Morton);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      int n_empty = 0;
+      for (int x=0; x<chip.dimX(); x++) {
+        for (int y=0; y<chip.dimY(); y++) {
+          int bid = chip.blockIdAt(x, y);
+          if (bid < 0) {
+            n_empty++;
+          } else {
+            QCOMPARE(chip.blockLoc(bid) == qMakePair(x, y), true);
+          }
+        }
+      }
+      QCOMPARE(n_empty, chip.dimX() * chip.dimY() - chip.numBlocks());
+
+      // elongated chips are only padded along each axis to a power of two
+      for (QPair<int,int> dims : {qMakePair(1000, 10), qMakePair(10, 1000), 
+          qMakePair(60, 40)}) {
+        QVector<QList<int>> nets;
+        int n_blocks = dims.first * dims.second / 2;
+        for (int bid=0; bid+1<n_blocks; bid++) {
+          nets.append(QList<int>() << bid << bid+1);
+        }
+        sp::Chip long_chip(dims.first, dims.second, n_blocks, nets);
+        pc::Placer long_placer(&long_chip);
+        long_placer.initBlockPos();
+        long_chip.setGridLayout(sp::GridLayout::Morton);
+        QCOMPARE(long_chip.gridStorageSize() < 2 * dims.first * dims.second, true);
+        QVERIFY(checkLegalPlacement(long_chip));
+        n_empty = 0;
+        for (int x=0; x<long_chip.dimX(); x++) {
+          for (int y=0; y<long_chip.dimY(); y++) {
+            n_empty += (long_chip.blockIdAt(x, y) < 0);
+          }
+        }
+        QCOMPARE(n_empty, dims.first * dims.second - n_blocks);
+      }
+    }
+
+    //! Test the sparse grid on a lightly populated chip, including empty 
+    //! cell moves that exercise the hash table deletions.
+    void testSparseGrid()
+    {
+      QVector<QList<int>> nets;
+      int n_blocks = 200;
+      for (int bid=0; bid+1<n_blocks; bid++) {
+        nets.append(QList<int>() << bid << bid+1 << (bid * 7) % n_blocks);
+      }
+      sp::Chip chip(60, 40, n_blocks, nets, sp::GridLayout::SparseHash);
+      QCOMPARE(chip.gridStorageSize(), 0);
+      pc::Placer placer(&chip);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.max_its = 100;
+      sa_settings.p_shift = 0.2;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.cost < results.init_cost, true);
+      int n_occupied = 0;
+      for (int x=0; x<chip.dimX(); x++) {
+        for (int y=0; y<chip.dimY(); y++) {
+          int bid = chip.blockIdAt(x, y);
+          if (bid >= 0) {
+            n_occupied++;
+            QCOMPARE(chip.blockLoc(bid) == qMakePair(x, y), true);
+          }
+        }
+      }
+      QCOMPARE(n_occupied, n_blocks);
+
+      // batches mark the blocks and the empty cells they touch
+      sa_settings.p_shift = 0;
+      sa_settings.batch_size = 8;
+      sa_settings.init_place = pc::InitPlace::ExistingInit;
+      results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      QVERIFY(checkLegalPlacement(chip));
+
+      // the placement survives switching back to a dense layout
+      qint64 cost = chip.calcCost();
+      chip.setGridLayout(sp::GridLayout::ColumnMajor);
+      QCOMPARE(chip.calcCost(), cost);
+      for (int bid=0; bid<n_blocks; bid++) {
+        QCOMPARE(chip.blockIdAt(chip.blockLoc(bid)), bid);
+      }
+    }
+
+    //! Test that the multiset bounding boxes of high fanout nets agree with 
+    //! the scan-based cost through swaps, compound moves and annealing.
+    void testHighFanoutNets()
+    {
+      int n_blocks = 300;
+      QVector<QList<int>> nets;
+      QList<int> clock_net, reset_net;
+      for (int bid=0; bid<n_blocks; bid++) {
+        clock_net.append(bid);
+        if (bid % 2 == 0) {
+          reset_net.append(bid);
+        }
+      }
+      reset_net.append(0);  // a block may appear more than once in a net
+      nets.append(clock_net);
+      nets.append(reset_net);
+      for (int bid=0; bid+1<n_blocks; bid++) {
+        nets.append(QList<int>() << bid << bid+1);
+      }
+      sp::Chip chip(20, 20, n_blocks, nets);
+      chip.setHighFanoutThreshold(64);
+      QCOMPARE(chip.numHighFanoutNets(), 2);
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      auto checkNetCosts = [&chip]() {
+        for (int net_id=0; net_id<chip.numNets(); net_id++) {
+          QCOMPARE(chip.costOfNet(net_id), chip.costOfNetScan(net_id));
+        }
+      };
+      checkNetCosts();
+
+      // swap deltas match those computed with the multisets disabled
+      std::mt19937 mt(1);
+      std::uniform_int_distribution<int> coord_dist(0, 19);
+      for (int i=0; i<200; i++) {
+        int x1 = coord_dist(mt), y1 = coord_dist(mt);
+        int x2 = coord_dist(mt), y2 = coord_dist(mt);
+        qint64 delta = chip.calcSwapCostDelta(x1, y1, x2, y2);
+        chip.setHighFanoutThreshold(-1);
+        QCOMPARE(chip.numHighFanoutNets(), 0);
+        QCOMPARE(chip.calcSwapCostDelta(x1, y1, x2, y2), delta);
+        chip.setHighFanoutThreshold(64);
+        int bid_1 = chip.blockIdAt(x1, y1);
+        chip.setLocBlock(qMakePair(x1, y1), chip.blockIdAt(x2, y2));
+        chip.setLocBlock(qMakePair(x2, y2), bid_1);
+        checkNetCosts();
+      }
+
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.p_shift = 0.1;
+      sa_settings.p_rotate = 0.1;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      checkNetCosts();
+    }
+
+    //! Test that net preprocessing shrinks the netlist and keeps costs and 
+    //! cost deltas identical.
+    void testNetPreprocessing()
+    {
+      QVector<QList<int>> nets;
+      nets << (QList<int>() << 0 << 1 << 2)
+        << (QList<int>() << 3)            // single pin, dropped
+        << (QList<int>() << 2 << 0 << 1)  // permutation of net 0, merged
+        << (QList<int>() << 4 << 4)       // one distinct block, dropped
+        << (QList<int>() << 1 << 3 << 3 << 4)
+        << (QList<int>() << 0 << 1 << 2 << 1);  // same blocks as net 0
+      sp::Chip raw_chip(4, 4, 5, nets);
+      sp::Chip chip(4, 4, 5, nets);
+      sp::NetReduction reduction = chip.preprocessNets();
+      QCOMPARE(reduction.nets_before, 6);
+      QCOMPARE(reduction.nets_after, 2);
+      QCOMPARE(reduction.pins_before, 17);
+      QCOMPARE(reduction.pins_after, 6);
+      QCOMPARE(chip.getGraph()->netWeight(0), 3);
+      QCOMPARE(chip.getGraph()->netWeight(1), 1);
+
+      // a larger problem, placed identically on both chips
+      QString p_path = ":/test_problems/alu2.txt";
+      sp::Chip raw_alu(p_path);
+      sp::Chip alu(p_path);
+      alu.preprocessNets();
+      for (sp::Chip *t_raw : {&raw_chip, &raw_alu}) {
+        sp::Chip *t_chip = (t_raw == &raw_chip) ? &chip : &alu;
+        pc::Placer placer(t_raw);
+        placer.initBlockPos();
+        for (int bid=0; bid<t_raw->numBlocks(); bid++) {
+          t_chip->setLocBlock(t_raw->blockLoc(bid), bid);
+        }
+        QCOMPARE(t_chip->calcCost(), t_raw->calcCost());
+        std::mt19937 mt(1);
+        std::uniform_int_distribution<int> x_dist(0, t_raw->dimX()-1);
+        std::uniform_int_distribution<int> y_dist(0, t_raw->dimY()-1);
+        for (int i=0; i<100; i++) {
+          int x1 = x_dist(mt), y1 = y_dist(mt), x2 = x_dist(mt), y2 = y_dist(mt);
+          QCOMPARE(t_chip->calcSwapCostDelta(x1, y1, x2, y2), 
+              t_raw->calcSwapCostDelta(x1, y1, x2, y2));
+        }
+      }
+
+      // detailed placement evaluates windows with the net weights
+      qint64 cost = alu.calcCost();
+      pc::DetailedPlacer dp(&alu);
+      QCOMPARE(cost + dp.refine(), alu.calcCost());
+    }
+
+    //! Test the cost model policies against hand computed net costs, and 
+    //! that deltas, annealing and detailed placement stay consistent.
+    void testCostModels()
+    {
+      QVector<QList<int>> nets;
+      nets << (QList<int>() << 0 << 1 << 2 << 3) << (QList<int>() << 1 << 4);
+      sp::Chip chip(4, 4, 5, nets);
+      chip.setLocBlock(qMakePair(0, 0), 0);
+      chip.setLocBlock(qMakePair(3, 0), 1);
+      chip.setLocBlock(qMakePair(0, 2), 2);
+      chip.setLocBlock(qMakePair(1, 1), 3);
+      chip.setLocBlock(qMakePair(3, 3), 4);
+      // net 0 spans dx=3, dy=2, net 1 spans dx=0, dy=3
+      QCOMPARE(chip.calcCost(), (qint64)((3 + 2*2) + (0 + 2*3)));
+      chip.setCostModel(sp::CostModel::WeightedHPWL);
+      QCOMPARE(chip.calcCost(), (qint64)(108 * (3 + 2*2) + 100 * (0 + 2*3)));
+      chip.setCostModel(sp::CostModel::SquaredDist);
+      QCOMPARE(chip.calcCost(), (qint64)((9 + 2*4) + (0 + 2*9)));
+      chip.setCostModel(sp::CostModel::Star);
+      // net 0: n*sum(x^2)-sum(x)^2 = 4*10-16 for x and 4*5-9 for y, divided
+      // by n; net 1: 0 for x and 2*9-9 for y
+      QCOMPARE(chip.calcCost(), (qint64)((24/4 + 2*(11/4)) + (0 + 2*(9/2))));
+      QCOMPARE(sp::StarModel::cost(sp::MomentAcc(), 0), (qint64)0);
+      sp::BBoxAcc acc;
+      acc.add(0, 0);
+      acc.add(3, 2);
+      QCOMPARE(sp::HPWLPolicy<1>::cost(acc, 2), (qint64)(3 + 2));
+      QCOMPARE(sp::SquaredDistPolicy<3>::cost(acc, 2), (qint64)(9 + 3*4));
+
+      // a 10k pin net across a 3540x3540 chip exceeds the int range under 
+      // the crossing count correction alone
+      QList<int> wide_net;
+      for (int bid=0; bid<10000; bid++) {
+        wide_net.append(bid);
+      }
+      QVector<QList<int>> wide_nets;
+      wide_nets.append(wide_net);
+      sp::Chip wide(3540, 3540, 10000, wide_nets, sp::GridLayout::SparseHash);
+      wide.setCostModel(sp::CostModel::WeightedHPWL);
+      for (int bid=0; bid<9999; bid++) {
+        wide.setLocBlock(qMakePair(bid % 3540, bid / 3540), bid);
+      }
+      wide.setLocBlock(qMakePair(3539, 3539), 9999);
+      qint64 factor = sp::WeightedHPWLModel::crossingFactor(10000);
+      QCOMPARE(wide.costOfNet(0), factor * (3539 + 2*3539));
+      QCOMPARE(wide.costOfNetScan(0), wide.costOfNet(0));
+      QCOMPARE(wide.calcCost() > std::numeric_limits<int>::max(), true);
+      QCOMPARE(wide.calcSwapCostDelta(3539, 3539, 3539, 3), factor * 2 * (3 - 3539));
+
+      for (sp::CostModel model : {sp::CostModel::WeightedHPWL,
+          sp::CostModel::SquaredDist, sp::CostModel::Star}) {
+        QString p_path = ":/test_problems/alu2.txt";
+        sp::Chip alu(p_path);
+        alu.setCostModel(model);
+        pc::Placer placer(&alu);
+        placer.initBlockPos();
+        qint64 cost = alu.calcCost();
+        QPair<int,int> loc_a = alu.blockLoc(0), loc_b = alu.blockLoc(1);
+        qint64 delta = alu.calcSwapCostDelta(loc_a.first, loc_a.second, 
+            loc_b.first, loc_b.second);
+        QCOMPARE(alu.calcCost(), cost);
+        alu.setLocBlock(loc_a, 1);
+        alu.setLocBlock(loc_b, 0);
+        QCOMPARE(alu.calcCost(), cost + delta);
+
+        pc::SASettings sa_settings;
+        sa_settings.gui_up = pc::GuiFinalOnly;
+        sa_settings.swap_fact = 1;
+        sa_settings.p_rotate = 0.1;
+        sa_settings.finish_mode = pc::FinishMode::WindowFinish;
+        pc::SAResults results = placer.runPlacer(sa_settings);
+        QCOMPARE(results.cost, alu.calcCost());
+        QCOMPARE(results.evaluations > 0, true);
+        QCOMPARE(results.cost < results.init_cost, true);
+      }
+    }
+
+    //! Test that the full cost of every cost model matches a 64-bit sum of
+    //! the net costs on a netlist large enough for the squared and star 
+    //! models to exceed the int range, and that the generator draws the 
+    //! same netlist from the same seed with any standard library.
+    void testLargeNetlistCost()
+    {
+      cli::GenSettings gen_settings;
+      gen_settings.n_blocks = 50000;
+      cli::NetlistGenerator gen(gen_settings);
+      gen.generate();
+      QCOMPARE(gen.getNets().first() == (QList<int>() << 32074 << 4536), true);
+      sp::Chip chip(gen.dimX(), gen.dimY(), gen_settings.n_blocks, gen.getNets());
+      pc::Placer placer(&chip);
+      placer.setSeed(1);
+      placer.initBlockPos();
+      qint64 max_sum = 0;
+      for (sp::CostModel model : {sp::CostModel::HPWL, sp::CostModel::WeightedHPWL,
+          sp::CostModel::SquaredDist, sp::CostModel::Star}) {
+        chip.setCostModel(model);
+        qint64 net_sum = 0;
+        for (int net_id=0; net_id<chip.numNets(); net_id++) {
+          net_sum += chip.costOfNet(net_id);
+        }
+        QCOMPARE(chip.calcCost(), net_sum);
+        max_sum = std::max(max_sum, net_sum);
+      }
+      QCOMPARE(max_sum > std::numeric_limits<int>::max(), true);
+    }
+
+    //! Test that the move loops compiled for every combination of options 
+    //! make the same moves as the generic move loop from the same seed, and
+    //! produce legal placements with consistent costs.
+    void testSpecializedLoop()
+    {
+      QString p_path = ":/test_problems/alu2.txt";
+      for (int flags=0; flags<24; flags++) {
+        pc::SASettings sa_settings;
+        sa_settings.gui_up = pc::GuiFinalOnly;
+        sa_settings.swap_fact = 0.5;
+        sa_settings.use_rw = (flags & 1);
+        sa_settings.p_shift = (flags & 2) ? 0.2 : 0;
+        sa_settings.directed_ratio = (flags & 4) ? 0.2 : 0;
+        sa_settings.block_order = static_cast<pc::BlockOrder>(flags / 8);
+        // the sanity checks are only run for a spread of the combinations
+        sa_settings.sanity_check = (flags % 5 == 0);
+        QList<QPair<int,int>> locs[2];
+        pc::SAResults results[2];
+        for (int specialized=0; specialized<2; specialized++) {
+          sp::Chip chip(p_path);
+          pc::Placer placer(&chip);
+          placer.setSeed(flags);
+          sa_settings.specialized_loop = specialized;
+          results[specialized] = placer.runPlacer(sa_settings);
+          QCOMPARE(results[specialized].cost, chip.calcCost());
+          QCOMPARE(results[specialized].cost < results[specialized].init_cost, true);
+          QVERIFY(checkLegalPlacement(chip));
+          for (int bid=0; bid<chip.numBlocks(); bid++) {
+            locs[specialized].append(chip.blockLoc(bid));
+          }
+        }
+        QCOMPARE(results[1].cost, results[0].cost);
+        QCOMPARE(results[1].moves, results[0].moves);
+        QCOMPARE(locs[1] == locs[0], true);
+      }
+    }
+
+    //! Test that the fixed-size engine is only picked for small chips and 
+    //! supported settings, and that it leaves a legal placement with a 
+    //! consistent cost on the chip.
+    void testSmallPlacer()
+    {
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sp::Chip alu(":/test_problems/alu2.txt");
+      QCOMPARE(pc::SmallPlacer::supports(&alu, sa_settings), false);
+
+      sp::Chip chip(":/benchmarks/cm151a.txt");
+      QCOMPARE(pc::SmallPlacer::supports(&chip, sa_settings), true);
+      pc::SASettings compound_settings = sa_settings;
+      compound_settings.p_shift = 0.1;
+      QCOMPARE(pc::SmallPlacer::supports(&chip, compound_settings), false);
+
+      pc::SmallPlacer placer(&chip);
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.cost, chip.getCost());
+      QCOMPARE(results.cost < results.init_cost, true);
+      QCOMPARE(results.moves > 0, true);
+      QVERIFY(checkLegalPlacement(chip));
+
+      // continuing from the annealed placement starts from its cost
+      sa_settings.init_place = pc::InitPlace::ExistingInit;
+      pc::SmallPlacer existing(&chip);
+      pc::SAResults existing_results = existing.runPlacer(sa_settings);
+      QCOMPARE(existing_results.init_cost, results.cost);
+      QCOMPARE(existing_results.cost, chip.calcCost());
+    }
+
+    //! Test that batched swap cost deltas match the individually evaluated
+    //! ones at every instruction set and that batched annealing keeps the 
+    //! cost consistent.
+    void testBatchedSwapDeltas()
+    {
+      for (sp::CostModel model : {sp::CostModel::HPWL, sp::CostModel::WeightedHPWL,
+          sp::CostModel::Star}) {
+        sp::Chip chip(":/test_problems/alu2.txt");
+        chip.setCostModel(model);
+        pc::Placer placer(&chip);
+        placer.initBlockPos();
+        QVector<sp::SwapCandidate> swaps;
+        for (int i=0; i<100; i++) {
+          sp::SwapCandidate swap = {(7*i) % chip.dimX(), (3*i) % chip.dimY(),
+            (11*i+5) % chip.dimX(), (13*i+1) % chip.dimY()};
+          swaps.append(swap);
+        }
+        for (sp::SimdLevel level : {sp::SimdLevel::Scalar, sp::SimdLevel::SSE41,
+            sp::SimdLevel::AVX2}) {
+          chip.setSimdLevel(level);
+          QVector<qint64> deltas;
+          chip.calcSwapCostDeltas(swaps, deltas);
+          QCOMPARE(deltas.size(), swaps.size());
+          for (int i=0; i<swaps.size(); i++) {
+            const sp::SwapCandidate &s = swaps[i];
+            QCOMPARE(deltas[i], chip.calcSwapCostDelta(s.x1, s.y1, s.x2, s.y2));
+          }
+        }
+      }
+
+      sp::Chip chip(":/test_problems/alu2.txt");
+      pc::Placer placer(&chip);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.batch_size = 16;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.cost < results.init_cost, true);
+    }
+
+    //! Test that the full cost is the sum of the net costs for every cost 
+    //! model, instruction set and thread count.
+    void testFullCostKernel()
+    {
+      for (sp::CostModel model : {sp::CostModel::HPWL, sp::CostModel::WeightedHPWL,
+          sp::CostModel::SquaredDist, sp::CostModel::Star}) {
+        sp::Chip chip(":/test_problems/alu2.txt");
+        chip.setCostModel(model);
+        chip.setHighFanoutThreshold(6);
+        pc::Placer placer(&chip);
+        placer.initBlockPos();
+        qint64 net_sum = 0;
+        for (int net_id=0; net_id<chip.numNets(); net_id++) {
+          net_sum += chip.costOfNet(net_id);
+        }
+        for (sp::SimdLevel level : {sp::SimdLevel::Scalar, sp::SimdLevel::SSE41,
+            sp::SimdLevel::AVX2}) {
+          chip.setSimdLevel(level);
+          for (int n_threads : {1, 3}) {
+            chip.setCostThreads(n_threads);
+            QCOMPARE(chip.calcCost(), net_sum);
+          }
+        }
+      }
+    }
+
+    //! Test that approximate deltas leave out the large nets, that batched 
+    //! approximate deltas agree with the single ones and that annealing with
+    //! approximate deltas ends with exact deltas and a consistent cost.
+    void testApproxCost()
+    {
+      sp::Chip chip(":/test_problems/alu2.txt");
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      QVector<sp::SwapCandidate> swaps;
+      for (int i=0; i<100; i++) {
+        sp::SwapCandidate swap = {(7*i) % chip.dimX(), (3*i) % chip.dimY(),
+          (11*i+5) % chip.dimX(), (13*i+1) % chip.dimY()};
+        swaps.append(swap);
+      }
+      QVector<qint64> exact;
+      chip.calcSwapCostDeltas(swaps, exact);
+      // no net is left out above the largest net size, every net at 0
+      chip.setApproxNetSize(chip.numBlocks());
+      QVector<qint64> deltas;
+      chip.calcSwapCostDeltas(swaps, deltas);
+      QCOMPARE(deltas == exact, true);
+      chip.setApproxNetSize(0);
+      for (const sp::SwapCandidate &s : swaps) {
+        QCOMPARE(chip.calcSwapCostDelta(s.x1, s.y1, s.x2, s.y2), (qint64)0);
+      }
+      chip.setApproxNetSize(3);
+      chip.calcSwapCostDeltas(swaps, deltas);
+      for (int i=0; i<swaps.size(); i++) {
+        const sp::SwapCandidate &s = swaps[i];
+        QCOMPARE(deltas[i], chip.calcSwapCostDelta(s.x1, s.y1, s.x2, s.y2));
+      }
+      chip.setApproxNetSize(-1);
+
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      sa_settings.approx_net_size = 3;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QCOMPARE(chip.approxNetSize(), -1);
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.cost < results.init_cost, true);
+    }
+
+    //! Test that rolling back the placement journal restores the placement
+    //! before and after the journal is replaced by a snapshot, and that a 
+    //! time budget cuts a long anneal short with a consistent cost.
+    void testTimeBudget()
+    {
+      sp::Chip chip(":/test_problems/alu2.txt");
+      chip.setHighFanoutThreshold(6);
+      pc::Placer placer(&chip);
+      placer.initBlockPos();
+      qint64 cost = chip.calcCost();
+      QList<QPair<int,int>> locs;
+      for (int bid=0; bid<chip.numBlocks(); bid++) {
+        locs.append(chip.blockLoc(bid));
+      }
+      // few swaps stay in the journal, many swaps replace it by a snapshot
+      for (int n_swaps : {5, 4 * chip.numBlocks()}) {
+        chip.startJournal();
+        for (int i=0; i<n_swaps; i++) {
+          QPair<int,int> a((7*i) % chip.dimX(), (3*i) % chip.dimY());
+          QPair<int,int> b((11*i+5) % chip.dimX(), (13*i+1) % chip.dimY());
+          int bid_a = chip.blockIdAt(a);
+          chip.setLocBlock(a, chip.blockIdAt(b));
+          chip.setLocBlock(b, bid_a);
+        }
+        chip.rollbackJournal();
+        chip.stopJournal();
+        for (int bid=0; bid<chip.numBlocks(); bid++) {
+          QCOMPARE(chip.blockLoc(bid) == locs[bid], true);
+          QCOMPARE(chip.blockIdAt(locs[bid]), bid);
+        }
+        QCOMPARE(chip.calcCost(), cost);
+      }
+
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.t_schd = pc::TSchd::ExpDecayTUpdate;
+      sa_settings.decay_b = 0.9999;
+      sa_settings.max_its_cost_unchanged = 100000;
+      sa_settings.max_its = 100000;
+      sa_settings.time_budget_ms = 300;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      // the budget ends the run long before the schedule would, rather than
+      // timing the run, which is at the mercy of the machine load
+      QCOMPARE(results.iterations > 0, true);
+      QCOMPARE(results.iterations < sa_settings.max_its, true);
+      QCOMPARE(chip.isJournaling(), false);
+      QCOMPARE(results.cost, chip.calcCost());
+      QCOMPARE(results.cost < results.init_cost, true);
+    }
+
+    //! Test that resuming from a checkpoint makes the same moves as the run
+    //! that wrote it, and that both end where a run of the same seed without
+    //! checkpointing ends, with and without rejection-free sampling and with
+    //! the best placement kept.
+    void testCheckpointResume()
+    {
+      QString cp_path = QDir::temp().filePath("placer_test_checkpoint.bin");
+      for (bool rejection_free : {false, true}) {
+        for (bool keep_best : {false, true}) {
+          pc::SASettings sa_settings;
+          sa_settings.gui_up = pc::GuiFinalOnly;
+          sa_settings.swap_fact = 1;
+          sa_settings.block_order = pc::BlockOrder::ShuffledSweep;
+          sa_settings.t_schd = pc::TSchd::ExpDecayTUpdate;
+          sa_settings.decay_b = 0.8;
+          sa_settings.rejection_free = rejection_free;
+          sa_settings.rf_threshold = 0.05;
+          sa_settings.max_its = 60;
+          if (keep_best) {
+            // heat up after a quench, so that the best placement is reached
+            // long before the last checkpoint and returned in the end
+            sa_settings.init_t_fact = 0.01;
+            sa_settings.decay_b = 1.1;
+            sa_settings.keep_best = true;
+          }
+
+          sp::Chip ref_chip(":/test_problems/alu2.txt");
+          pc::Placer ref_placer(&ref_chip);
+          ref_placer.setSeed(7);
+          pc::SAResults ref = ref_placer.runPlacer(sa_settings);
+          if (keep_best) {
+            // the best placement must beat the last one for restoring it to
+            // be put to the test
+            pc::SASettings last_settings = sa_settings;
+            last_settings.keep_best = false;
+            sp::Chip last_chip(":/test_problems/alu2.txt");
+            pc::Placer last_placer(&last_chip);
+            last_placer.setSeed(7);
+            QCOMPARE(last_placer.runPlacer(last_settings).cost > ref.cost, true);
+          }
+
+          // the last checkpoint of a run is the state after its last multiple
+          // of the interval, the resumed run must end where it ended
+          sp::Chip chip(":/test_problems/alu2.txt");
+          pc::Placer placer(&chip);
+          placer.setSeed(7);
+          placer.setCheckpointing(cp_path, 7);
+          pc::SAResults results = placer.runPlacer(sa_settings);
+
+          sp::Chip resumed_chip(":/test_problems/alu2.txt");
+          pc::Placer resumed_placer(&resumed_chip);
+          pc::SAResults resumed = resumed_placer.resumePlacer(sa_settings, cp_path);
+          for (const pc::SAResults &res : {results, resumed}) {
+            QCOMPARE(res.cost, ref.cost);
+            QCOMPARE(res.iterations, ref.iterations);
+            QCOMPARE(res.moves, ref.moves);
+            QCOMPARE(res.init_cost, ref.init_cost);
+          }
+          for (int bid=0; bid<ref_chip.numBlocks(); bid++) {
+            QCOMPARE(chip.blockLoc(bid) == ref_chip.blockLoc(bid), true);
+            QCOMPARE(resumed_chip.blockLoc(bid) == ref_chip.blockLoc(bid), true);
+          }
+        }
+      }
+
+      // checkpoints of other problems are refused
+      sp::Chip other_chip(":/test_problems/apex1.txt");
+      pc::Placer other_placer(&other_chip);
+      QCOMPARE(other_placer.resumePlacer(pc::SASettings(), cp_path).cost, (qint64)-1);
+      QFile::remove(cp_path);
+    }
+
+    //! Test that ECO placement keeps the surviving blocks at their cells, 
+    //! inserts new blocks and only anneals around them.
+    void testEcoPlacement()
+    {
+      QString place_path = QDir::temp().filePath("placer_test_placement.txt");
+      sp::Chip chip(":/test_problems/alu2.txt");
+      pc::Placer placer(&chip);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      pc::SAResults results = placer.runPlacer(sa_settings);
+      QVERIFY(chip.writePlacement(place_path));
+
+      // the changed netlist has two new blocks on a new net
+      QVector<QList<int>> nets;
+      for (const QList<int> &net : chip.getGraph()->getNets()) {
+        nets.append(net);
+      }
+      int n_blocks = chip.numBlocks();
+      nets.append(QList<int>() << n_blocks << n_blocks+1 << 0 << 1);
+      sp::Chip eco_chip(chip.dimX(), chip.dimY(), n_blocks+2, nets);
+      pc::EcoPlacer eco(&eco_chip);
+      QVERIFY(eco.loadPlacement(place_path));
+      QCOMPARE(eco.insertedBlocks().size(), 2);
+      for (int bid=0; bid<n_blocks; bid++) {
+        QCOMPARE(eco_chip.blockLoc(bid) == chip.blockLoc(bid), true);
+      }
+      pc::SAResults eco_results = eco.refine(sa_settings);
+      QCOMPARE(eco_results.cost, eco_chip.calcCost());
+      QCOMPARE(eco_results.cost <= eco_results.init_cost, true);
+      QCOMPARE(eco_results.moves < results.moves / 10, true);
+      QFile::remove(place_path);
+    }
+
+    //! Test that interleaved step calls of two placers stay within their
+    //! move counts and finish their runs, and that cancel stops a run.
+    void testStepwisePlacer()
+    {
+      sp::Chip chip_a(":/test_problems/alu2.txt");
+      sp::Chip chip_b(":/test_problems/apex1.txt");
+      pc::Placer placer_a(&chip_a);
+      pc::Placer placer_b(&chip_b);
+      pc::SASettings sa_settings;
+      sa_settings.gui_up = pc::GuiFinalOnly;
+      sa_settings.swap_fact = 1;
+      QVERIFY(placer_a.init(sa_settings));
+      QVERIFY(placer_b.init(sa_settings));
+      long total_moves = 0;
+      while (!placer_a.isDone() || !placer_b.isDone()) {
+        if (!placer_a.isDone()) {
+          pc::SAProgress progress = placer_a.step(1000);
+          QCOMPARE(progress.moves <= 1000, true);
+          QCOMPARE(progress.total_moves, total_moves + progress.moves);
+          QCOMPARE(progress.cost, chip_a.getCost());
+          total_moves = progress.total_moves;
+        }
+        placer_b.step(1000);
+      }
+      pc::SAResults results = placer_a.results();
+      QCOMPARE(results.moves, total_moves);
+      QCOMPARE(results.cost, chip_a.calcCost());
+      QCOMPARE(placer_b.results().cost, chip_b.calcCost());
+
+      // a cancelled run ends without the remaining steps
+      QVERIFY(placer_a.init(sa_settings));
+      total_moves = 0;
+      for (int i=0; i<5; i++) {
+        total_moves += placer_a.step(1000).moves;
+      }
+      placer_a.cancel();
+      pc::SAProgress progress = placer_a.step(1000);
+      QCOMPARE(progress.done, true);
+      QCOMPARE(progress.moves, 0L);
+      QCOMPARE(placer_a.results().cancelled, true);
+      QCOMPARE(placer_a.results().moves, total_moves);
+      QCOMPARE(placer_a.results().cost, chip_a.calcCost());
     }
 
 };